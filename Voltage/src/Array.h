@@ -2,6 +2,7 @@
 #define VOLTAGE_ARRAY_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <initializer_list>
 
 namespace voltage {
@@ -17,6 +18,9 @@ class Array {
   Array(const std::initializer_list<T> il) : Array(il.size()) {
     std::copy(il.begin(), il.end(), elements);
   }
+  Array(const Array&) = delete;
+  Array& operator=(const Array&) = delete;
+  ~Array() { delete[] elements; }
 
   T& operator[](const int index) const { return elements[index]; }
   size_t getCapacity() const { return capacity; }
@@ -33,6 +37,8 @@ class Buffer : public Array<T> {
   uint32_t getSize() const { return index; }
   void clear() { index = 0; }
   void push(const T& element) { Array<T>::elements[index++] = element; }
+  void pop() { index--; }
+  void truncate(const uint32_t size) { index = size; }
   T& getLast() { return Array<T>::elements[index - 1]; }
   T* getElements() { return Array<T>::elements; }
 };
@@ -2,26 +2,45 @@
 #define VOLTAGE_CAMERA_H_
 
 #include "raymath.h"
+#include "utils.h"
 
 namespace voltage {
 
+// The view and projection matrices are computed when requested after a change. Subclasses should
+// call invalidateView whenever their view changes, so that the revision is updated as well.
 class Camera {
  protected:
   float fov, aspect, near, far;
   Matrix viewMatrix, projectionMatrix;
+  bool isViewMatrixDirty = true;
+  bool isProjectionMatrixDirty = true;
+  uint32_t revision;
+
+  void invalidateView() {
+    isViewMatrixDirty = true;
+    revision = nextRevision();
+  }
 
  public:
   Camera(float fov = M_PI_4, float aspect = 1.0, float near = 0.01, float far = 100.0)
-      : fov(fov), aspect(aspect), near(near), far(far) {
+      : fov(fov), aspect(aspect), near(near), far(far), revision(nextRevision()) {
     viewMatrix = MatrixIdentity();
     projectionMatrix = MatrixIdentity();
   }
 
+  virtual ~Camera() {}
+
   virtual Matrix& getViewMatrix() = 0;
   virtual Matrix& getProjectionMatrix() {
-    projectionMatrix = MatrixPerspective(fov, aspect, near, far);
+    if (isProjectionMatrixDirty) {
+      projectionMatrix = MatrixPerspective(fov, aspect, near, far);
+      isProjectionMatrixDirty = false;
+    }
     return projectionMatrix;
   };
+
+  // Changes whenever the view or projection changes
+  uint32_t getRevision() const { return revision; }
 };
 
 class FreeCamera : public Camera {
@@ -33,13 +52,22 @@ class FreeCamera : public Camera {
   FreeCamera() : Camera() {}
 
   Matrix& getViewMatrix() {
-    viewMatrix = MatrixMultiply(MatrixTranslate(-translation.x, -translation.y, -translation.z),
-                                MatrixRotateXYZ({-rotation.x, -rotation.y, -rotation.z}));
+    if (isViewMatrixDirty) {
+      viewMatrix = MatrixMultiply(MatrixTranslate(-translation.x, -translation.y, -translation.z),
+                                  MatrixRotateXYZ({-rotation.x, -rotation.y, -rotation.z}));
+      isViewMatrixDirty = false;
+    }
     return viewMatrix;
   }
 
-  void setRotation(float x, float y, float z) { rotation = {x, y, z}; }
-  void setTranslation(float x, float y, float z) { translation = {x, y, z}; }
+  void setRotation(float x, float y, float z) {
+    rotation = {x, y, z};
+    invalidateView();
+  }
+  void setTranslation(float x, float y, float z) {
+    translation = {x, y, z};
+    invalidateView();
+  }
 };
 
 class LookAtCamera : public Camera {
@@ -52,12 +80,21 @@ class LookAtCamera : public Camera {
   LookAtCamera() : Camera() {}
 
   Matrix& getViewMatrix() {
-    viewMatrix = MatrixLookAt(eye, target, up);
+    if (isViewMatrixDirty) {
+      viewMatrix = MatrixLookAt(eye, target, up);
+      isViewMatrixDirty = false;
+    }
     return viewMatrix;
   }
 
-  void setEye(float x, float y, float z) { eye = {x, y, z}; }
-  void setTarget(float x, float y, float z) { target = {x, y, z}; }
+  void setEye(float x, float y, float z) {
+    eye = {x, y, z};
+    invalidateView();
+  }
+  void setTarget(float x, float y, float z) {
+    target = {x, y, z};
+    invalidateView();
+  }
 };
 
 };  // namespace voltage
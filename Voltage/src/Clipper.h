@@ -10,6 +10,60 @@ struct Viewport {
   float left, right, top, bottom;
 };
 
+inline bool isInside(const Vector2& point, const Viewport& vp) {
+  return point.x >= vp.left && point.x <= vp.right && point.y >= vp.bottom && point.y <= vp.top;
+}
+
+// Return values for bounding volume tests
+enum class Intersection { Inside, Outside, Partial };
+
+// View frustum planes in view space, extracted from the projection matrix and limited to the
+// viewport in normalized device coordinates. Plane normals point inside the frustum.
+struct Frustum {
+  Vector4 planes[6];
+
+  Frustum(const Matrix& m, const Viewport& vp) {
+    // Rows of the projection matrix, i.e. clip space coordinates as functions of view space
+    Vector4 x = {m.m0, m.m4, m.m8, m.m12};
+    Vector4 y = {m.m1, m.m5, m.m9, m.m13};
+    Vector4 z = {m.m2, m.m6, m.m10, m.m14};
+    Vector4 w = {m.m3, m.m7, m.m11, m.m15};
+
+    setPlane(0, x, w, 1.0, -vp.left);
+    setPlane(1, x, w, -1.0, vp.right);
+    setPlane(2, y, w, 1.0, -vp.bottom);
+    setPlane(3, y, w, -1.0, vp.top);
+    setPlane(4, z, w, 1.0, 1.0);
+    setPlane(5, z, w, -1.0, 1.0);
+  }
+
+  Intersection testSphere(const Vector3& center, const float radius) const {
+    Intersection result = Intersection::Inside;
+
+    for (int i = 0; i < 6; i++) {
+      const Vector4& p = planes[i];
+      float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+      if (distance < -radius) {
+        return Intersection::Outside;
+      }
+      if (distance < radius) {
+        result = Intersection::Partial;
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  // Set plane i to a * row + b * w and normalize it
+  void setPlane(const int i, const Vector4& row, const Vector4& w, const float a, const float b) {
+    Vector4 p = {a * row.x + b * w.x, a * row.y + b * w.y, a * row.z + b * w.z,
+                 a * row.w + b * w.w};
+    float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+    planes[i] = {p.x / length, p.y / length, p.z / length, p.w / length};
+  }
+};
+
 static int clipTest(float p, float q, float& u1, float& u2) {
   float r;
   bool value = true;
@@ -62,35 +116,50 @@ inline bool clipLine(Vector2& a, Vector2& b, const Viewport& vp) {
 // Return values for 3D clipping
 enum class ClipResult { Inside, Outside, AClipped, BClipped, BothClipped };
 
-enum class ClipPlane { Near, Far };
-enum { CodeNear = 0x1, CodeFar = 0x2 };
+// Outcode bits for the planes of the view volume in homogeneous clip space
+enum {
+  CodeLeft = 0x1,
+  CodeRight = 0x2,
+  CodeBottom = 0x4,
+  CodeTop = 0x8,
+  CodeNear = 0x10,
+  CodeFar = 0x20
+};
 typedef int unsigned OutCode;
+const int clipPlaneCount = 6;
+
+// Signed distances from a clip space position to the view volume planes, positive inside. The
+// left, right, bottom and top planes are derived from the viewport.
+inline void getPlaneDistances(const Vector4& v, const Viewport& vp, float* distances) {
+  distances[0] = v.x - vp.left * v.w;
+  distances[1] = vp.right * v.w - v.x;
+  distances[2] = v.y - vp.bottom * v.w;
+  distances[3] = vp.top * v.w - v.y;
+  distances[4] = v.z + v.w;
+  distances[5] = v.w - v.z;
+}
 
-inline OutCode getOutCode(const Vector4& vector) {
+inline OutCode getOutCode(const float* distances) {
   OutCode outCode = 0;
-  if (vector.z < -vector.w) {
-    outCode |= CodeNear;
-  }
-  if (-vector.z < -vector.w) {
-    outCode |= CodeFar;
+  for (int i = 0; i < clipPlaneCount; i++) {
+    if (distances[i] < 0) {
+      outCode |= 1 << i;
+    }
   }
   return outCode;
 }
 
-inline float getDistanceToPlane(const Vector4& vector, const ClipPlane plane) {
-  return plane == ClipPlane::Near ? vector.z + vector.w : -vector.z + vector.w;
-}
-
-inline Vector4 clipAgainstPlane(const Vector4& a, const Vector4& b, const ClipPlane plane) {
-  float da = getDistanceToPlane(a, plane);
-  float db = getDistanceToPlane(b, plane);
-  float t = da / (da - db);
-  return Vector4Lerp(a, b, t);
-}
+// Clip a line against all six planes of the view volume in one pass. Lines are trivially accepted
+// or rejected with outcodes, and the remaining ones are clipped parametrically (Liang–Barsky in
+// homogeneous coordinates) only against the planes the endpoints are outside of.
+inline ClipResult clipLine(Vector4& a, Vector4& b, const Viewport& vp) {
+  float aDistances[clipPlaneCount];
+  float bDistances[clipPlaneCount];
+  getPlaneDistances(a, vp, aDistances);
+  getPlaneDistances(b, vp, bDistances);
 
-inline ClipResult clipLineNearAndFar(Vector4& a, Vector4& b) {
-  OutCode aOutCode = getOutCode(a);
-  OutCode bOutCode = getOutCode(b);
+  OutCode aOutCode = getOutCode(aDistances);
+  OutCode bOutCode = getOutCode(bDistances);
 
   // Both outside
   if (aOutCode & bOutCode) {
@@ -102,20 +171,32 @@ inline ClipResult clipLineNearAndFar(Vector4& a, Vector4& b) {
     return ClipResult::Inside;
   }
 
-  // A is clipped
-  if (aOutCode & CodeNear) {
-    a = clipAgainstPlane(a, b, ClipPlane::Near);
+  float t0 = 0;
+  float t1 = 1.0;
+  OutCode outCode = aOutCode | bOutCode;
+
+  for (int i = 0; i < clipPlaneCount; i++) {
+    if (outCode & (1 << i)) {
+      float t = aDistances[i] / (aDistances[i] - bDistances[i]);
+      if (aDistances[i] < 0) {
+        t0 = fmaxf(t0, t);
+      } else {
+        t1 = fminf(t1, t);
+      }
+    }
   }
-  if (aOutCode & CodeFar) {
-    a = clipAgainstPlane(a, b, ClipPlane::Far);
+
+  // Outside of different planes, but the line passes by the view volume
+  if (t0 > t1) {
+    return ClipResult::Outside;
   }
 
-  // B is clipped
-  if (bOutCode & CodeNear) {
-    b = clipAgainstPlane(a, b, ClipPlane::Near);
+  Vector4 start = a;
+  if (aOutCode) {
+    a = Vector4Lerp(start, b, t0);
   }
-  if (bOutCode & CodeFar) {
-    b = clipAgainstPlane(a, b, ClipPlane::Far);
+  if (bOutCode) {
+    b = Vector4Lerp(start, b, t1);
   }
 
   if (aOutCode && bOutCode) {
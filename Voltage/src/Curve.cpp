@@ -0,0 +1,258 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include <algorithm>
+
+#include "Curve.h"
+
+using namespace voltage;
+
+static const float fullTurn = 2 * PI;
+
+// Crossings per boundary are at most three for a cubic and two per turn for an ellipse
+static const uint32_t maxRoots = 4 * 3;
+static const uint32_t bisectionIterations = 24;
+
+// Insertion sort, as the arrays hold only a handful of values
+static void sortValues(float* values, const uint32_t count) {
+  for (uint32_t i = 1; i < count; i++) {
+    float value = values[i];
+    uint32_t j = i;
+    for (; j > 0 && values[j - 1] > value; j--) {
+      values[j] = values[j - 1];
+    }
+    values[j] = value;
+  }
+}
+
+Curve Curve::fromArc(const Arc& arc) {
+  float end = fmaxf(fminf(arc.endAngle, arc.startAngle + fullTurn), arc.startAngle - fullTurn);
+  return {CurveType::Ellipse,
+          {arc.center, {arc.radius, 0}, {0, arc.radius}, {0, 0}},
+          {arc.startAngle, end},
+          arc.brightness,
+          false};
+}
+
+Curve Curve::fromEllipse(const Ellipse& ellipse) {
+  float c = cosf(ellipse.rotation);
+  float s = sinf(ellipse.rotation);
+  return {CurveType::Ellipse,
+          {ellipse.center,
+           {ellipse.radii.x * c, ellipse.radii.x * s},
+           {-ellipse.radii.y * s, ellipse.radii.y * c},
+           {0, 0}},
+          {0, fullTurn},
+          ellipse.brightness,
+          false};
+}
+
+// Degree elevation: the cubic control points are two thirds of the way to the quadratic one
+Curve Curve::fromBezier(const QuadraticBezier& bezier) {
+  Vector2 controlA = Vector2Lerp(bezier.a, bezier.control, 2.0f / 3);
+  Vector2 controlB = Vector2Lerp(bezier.b, bezier.control, 2.0f / 3);
+  return {CurveType::Bezier,
+          {bezier.a, controlA, controlB, bezier.b},
+          {0, 1.0},
+          bezier.brightness,
+          false};
+}
+
+Curve Curve::fromBezier(const CubicBezier& bezier) {
+  return {CurveType::Bezier,
+          {bezier.a, bezier.controlA, bezier.controlB, bezier.b},
+          {0, 1.0},
+          bezier.brightness,
+          false};
+}
+
+Vector2 Curve::getPoint(const float t) const {
+  if (type == CurveType::Ellipse) {
+    float c = cosf(t);
+    float s = sinf(t);
+    return {points[0].x + points[1].x * c + points[2].x * s,
+            points[0].y + points[1].y * c + points[2].y * s};
+  }
+
+  float u = 1.0f - t;
+  float b0 = u * u * u;
+  float b1 = 3 * u * u * t;
+  float b2 = 3 * u * t * t;
+  float b3 = t * t * t;
+  return {b0 * points[0].x + b1 * points[1].x + b2 * points[2].x + b3 * points[3].x,
+          b0 * points[0].y + b1 * points[1].y + b2 * points[2].y + b3 * points[3].y};
+}
+
+// Bounding box of the whole curve: the convex hull of the control points for Bezier curves, and
+// the extent of the full ellipse for elliptical arcs
+static void getBounds(const Curve& curve, Vector2& min, Vector2& max) {
+  if (curve.type == CurveType::Ellipse) {
+    Vector2 extent = {sqrtf(curve.points[1].x * curve.points[1].x +
+                            curve.points[2].x * curve.points[2].x),
+                      sqrtf(curve.points[1].y * curve.points[1].y +
+                            curve.points[2].y * curve.points[2].y)};
+    min = Vector2Subtract(curve.points[0], extent);
+    max = Vector2Add(curve.points[0], extent);
+    return;
+  }
+
+  min = max = curve.points[0];
+  for (uint32_t i = 1; i < 4; i++) {
+    min = {fminf(min.x, curve.points[i].x), fminf(min.y, curve.points[i].y)};
+    max = {fmaxf(max.x, curve.points[i].x), fmaxf(max.y, curve.points[i].y)};
+  }
+}
+
+// Angles in [t0, t1] where center + u * cos(t) + v * sin(t) = value, one coordinate at a time.
+// The sum is r * cos(t - phase), so the crossings are at phase +- acos((value - center) / r).
+static void findEllipseRoots(const float center, const float u, const float v, const float value,
+                             const float t0, const float t1, float* roots, uint32_t& rootCount) {
+  float r = sqrtf(u * u + v * v);
+  float d = value - center;
+  if (r == 0 || fabsf(d) > r) {
+    return;
+  }
+
+  float phase = atan2f(v, u);
+  float offset = acosf(d / r);
+  float angles[] = {phase - offset, phase + offset};
+  for (uint32_t i = 0; i < 2; i++) {
+    float t = angles[i] - floorf((angles[i] - t0) / fullTurn) * fullTurn;
+    for (; t <= t1 && rootCount < maxRoots; t += fullTurn) {
+      roots[rootCount++] = t;
+    }
+  }
+}
+
+// Parameters in [t0, t1] where one coordinate of a cubic Bezier equals the value. The curve is
+// split at the zeros of the derivative, and the roots are bisected in the monotone pieces.
+static void findBezierRoots(const float p0, const float p1, const float p2, const float p3,
+                            const float value, const float t0, const float t1, float* roots,
+                            uint32_t& rootCount) {
+  // Power basis: a * t^3 + b * t^2 + c * t + d
+  float a = -p0 + 3 * p1 - 3 * p2 + p3;
+  float b = 3 * p0 - 6 * p1 + 3 * p2;
+  float c = -3 * p0 + 3 * p1;
+  float d = p0 - value;
+  auto evaluate = [&](const float t) { return ((a * t + b) * t + c) * t + d; };
+
+  // Zeros of 3a * t^2 + 2b * t + c
+  float splits[4] = {t0};
+  uint32_t splitCount = 1;
+  auto addSplit = [&](const float t) {
+    if (t > t0 && t < t1) {
+      splits[splitCount++] = t;
+    }
+  };
+  if (fabsf(a) > 1e-7f) {
+    float discriminant = b * b - 3 * a * c;
+    if (discriminant >= 0) {
+      float root = sqrtf(discriminant);
+      addSplit((-b - root) / (3 * a));
+      addSplit((-b + root) / (3 * a));
+    }
+  } else if (fabsf(b) > 1e-7f) {
+    addSplit(-c / (2 * b));
+  }
+  sortValues(splits + 1, splitCount - 1);
+  splits[splitCount] = t1;
+
+  for (uint32_t i = 0; i < splitCount && rootCount < maxRoots; i++) {
+    float lo = splits[i];
+    float hi = splits[i + 1];
+    float fLo = evaluate(lo);
+    float fHi = evaluate(hi);
+    if ((fLo < 0) == (fHi < 0)) {
+      continue;
+    }
+
+    for (uint32_t j = 0; j < bisectionIterations; j++) {
+      float mid = (lo + hi) * 0.5f;
+      float fMid = evaluate(mid);
+      if ((fMid < 0) == (fLo < 0)) {
+        lo = mid;
+        fLo = fMid;
+      } else {
+        hi = mid;
+      }
+    }
+    roots[rootCount++] = (lo + hi) * 0.5f;
+  }
+}
+
+// The boundary crossings split the parameter range into intervals that are either completely
+// inside or completely outside the viewport, so testing the midpoint of each is enough
+uint32_t voltage::clipCurve(const Curve& curve, const Viewport& viewport, Curve* parts,
+                            const uint32_t maxParts) {
+  if (maxParts == 0) {
+    return 0;
+  }
+
+  Vector2 min, max;
+  getBounds(curve, min, max);
+  if (max.x < viewport.left || min.x > viewport.right || max.y < viewport.bottom ||
+      min.y > viewport.top) {
+    return 0;
+  }
+  if (isInside(min, viewport) && isInside(max, viewport)) {
+    parts[0] = curve;
+    parts[0].isClipped = min.x == viewport.left || max.x == viewport.right ||
+                         min.y == viewport.bottom || max.y == viewport.top;
+    return 1;
+  }
+
+  bool isReversed = curve.range.b < curve.range.a;
+  float t0 = isReversed ? curve.range.b : curve.range.a;
+  float t1 = isReversed ? curve.range.a : curve.range.b;
+
+  float roots[maxRoots + 2];
+  uint32_t rootCount = 0;
+  const Vector2* p = curve.points;
+  float xBounds[] = {viewport.left, viewport.right};
+  float yBounds[] = {viewport.bottom, viewport.top};
+  for (uint32_t i = 0; i < 2; i++) {
+    if (curve.type == CurveType::Ellipse) {
+      findEllipseRoots(p[0].x, p[1].x, p[2].x, xBounds[i], t0, t1, roots, rootCount);
+      findEllipseRoots(p[0].y, p[1].y, p[2].y, yBounds[i], t0, t1, roots, rootCount);
+    } else {
+      findBezierRoots(p[0].x, p[1].x, p[2].x, p[3].x, xBounds[i], t0, t1, roots, rootCount);
+      findBezierRoots(p[0].y, p[1].y, p[2].y, p[3].y, yBounds[i], t0, t1, roots, rootCount);
+    }
+  }
+
+  roots[rootCount++] = t0;
+  roots[rootCount++] = t1;
+  sortValues(roots, rootCount);
+
+  // Collect the inside intervals, merging the ones that touch
+  Pair<float> intervals[maxRoots + 1];
+  uint32_t intervalCount = 0;
+  for (uint32_t i = 0; i + 1 < rootCount; i++) {
+    float a = roots[i];
+    float b = roots[i + 1];
+    if (b <= a || !isInside(curve.getPoint((a + b) * 0.5f), viewport)) {
+      continue;
+    }
+
+    if (intervalCount > 0 && intervals[intervalCount - 1].b == a) {
+      intervals[intervalCount - 1].b = b;
+    } else {
+      intervals[intervalCount++] = {a, b};
+    }
+  }
+
+  uint32_t partCount = std::min(intervalCount, maxParts);
+  for (uint32_t i = 0; i < partCount; i++) {
+    parts[i] = curve;
+    parts[i].isClipped = true;
+    if (isReversed) {
+      const Pair<float>& interval = intervals[intervalCount - 1 - i];
+      parts[i].range = {interval.b, interval.a};
+    } else {
+      parts[i].range = intervals[i];
+    }
+  }
+
+  return partCount;
+}
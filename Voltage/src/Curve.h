@@ -0,0 +1,43 @@
+#ifndef VOLTAGE_CURVE_H_
+#define VOLTAGE_CURVE_H_
+
+#include <cstdint>
+
+#include "Clipper.h"
+#include "types.h"
+
+namespace voltage {
+
+enum class CurveType { Bezier, Ellipse };
+
+// Curve drawn over a range of its parameter. Bezier curves are cubic, given by the four control
+// points, with the parameter going from zero to one. Elliptical arcs are given by the center and
+// the axis vectors (pointing at angles zero and pi / 2), with the angle as the parameter.
+struct Curve {
+  CurveType type;
+  Vector2 points[4];
+  Pair<float> range;
+  float brightness;
+  // Set by clipCurve for parts that were cut at (or touch) the viewport boundary, whose samples
+  // are clamped to the DAC range when drawn
+  bool isClipped;
+
+  static Curve fromArc(const Arc& arc);
+  static Curve fromEllipse(const Ellipse& ellipse);
+  static Curve fromBezier(const QuadraticBezier& bezier);
+  static Curve fromBezier(const CubicBezier& bezier);
+
+  Vector2 getPoint(const float t) const;
+  Vector2 getStart() const { return getPoint(range.a); }
+  Vector2 getEnd() const { return getPoint(range.b); }
+};
+
+// Split the curve into the parts of its parameter range inside the viewport. The boundary
+// crossings are solved analytically for ellipses and by bisection between the extrema for Bezier
+// curves. Returns the number of parts written (at most maxParts).
+uint32_t clipCurve(const Curve& curve, const Viewport& viewport, Curve* parts,
+                   const uint32_t maxParts);
+
+}  // namespace voltage
+
+#endif
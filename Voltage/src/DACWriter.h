@@ -30,6 +30,12 @@ class Teensy36Writer : public DualDACWriter {
     DAC1_C0 = DAC_C0_DACEN | DAC_C0_DACRFS;  // 3.3V VDDA is DACREF_2
     *(volatile aliased_int16_t *)&(DAC1_DAT0L) = b;
   }
+
+  inline void writeBatch(const uint32_t *samples, uint32_t count) const {
+    for (uint32_t i = 0; i < count; i++) {
+      write(samples[i] & 0xFFFF, samples[i] >> 16);
+    }
+  }
 };
 
 class MCP4922Writer : public SingleDACWriter {
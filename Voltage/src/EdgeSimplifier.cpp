@@ -0,0 +1,200 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include "EdgeSimplifier.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace voltage;
+
+// Directions from the start of a line, counterclockwise from the low to the high one
+struct Cone {
+  Vector2 low, high;
+};
+
+static inline float cross(const Vector2& a, const Vector2& b) { return a.x * b.y - a.y * b.x; }
+
+static inline float getLengthSquared(const Vector2& v) { return v.x * v.x + v.y * v.y; }
+
+static inline bool isSamePoint(const Vector2& a, const Vector2& b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+// Narrow the directions that keep the vertices merged into a line within the maximum deviation to
+// those keeping the vertex v (relative to the start of the line) within it too. These are the
+// directions of v rotated both ways by up to the angle whose sine is the deviation over the length
+// of v. The rotated vectors are scaled by the length, which needs a single square root.
+static inline void narrowCone(Cone& cone, bool& hasCone, const Vector2& v,
+                              const float lengthSquared, const float maxDeviation) {
+  float maxDeviationSquared = maxDeviation * maxDeviation;
+  if (lengthSquared <= maxDeviationSquared) {
+    return;
+  }
+
+  float c = sqrtf(lengthSquared - maxDeviationSquared);
+  float s = maxDeviation;
+  Vector2 low = {v.x * c + v.y * s, v.y * c - v.x * s};
+  Vector2 high = {v.x * c - v.y * s, v.y * c + v.x * s};
+  if (!hasCone) {
+    cone = {low, high};
+    hasCone = true;
+    return;
+  }
+  if (cross(cone.low, low) > 0) {
+    cone.low = low;
+  }
+  if (cross(high, cone.high) > 0) {
+    cone.high = high;
+  }
+}
+
+static inline bool isInside(const Cone& cone, const bool hasCone, const Vector2& v) {
+  return !hasCone || (cross(cone.low, v) >= 0 && cross(v, cone.high) >= 0);
+}
+
+static inline uint32_t getBits(const float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Hash of the endpoints of a line, independent of its direction
+static inline uint32_t getHash(const Line& line) {
+  uint32_t ha = getBits(line.a.x) * 73856093u ^ getBits(line.a.y) * 19349663u;
+  uint32_t hb = getBits(line.b.x) * 73856093u ^ getBits(line.b.y) * 19349663u;
+  uint32_t h = (ha + hb) ^ (ha * hb);
+  return h ^ (h >> 15);
+}
+
+static inline bool isSameLine(const Line& a, const Line& b) {
+  if (a.brightness != b.brightness) {
+    return false;
+  }
+  return (isSamePoint(a.a, b.a) && isSamePoint(a.b, b.b)) ||
+         (isSamePoint(a.a, b.b) && isSamePoint(a.b, b.a));
+}
+
+// The maximum number of lines rounded up to a power of two
+static uint32_t getSlotCount(const uint32_t maxLines) {
+  uint32_t count = 1;
+  while (count < maxLines) {
+    count <<= 1;
+  }
+  return count;
+}
+
+EdgeSimplifier::EdgeSimplifier(const float minLength, const float tolerance,
+                               const uint32_t maxLines)
+    : minLength(minLength),
+      tolerance(tolerance),
+      slots(getSlotCount(maxLines)),
+      removedLineCount(0) {
+  std::fill(&slots[0], &slots[0] + slots.getCapacity(), 0);
+}
+
+void EdgeSimplifier::simplify(Buffer<Line>& lines, const uint32_t first, const float scale) {
+  uint32_t size = lines.getSize();
+  uint32_t output = simplifyRuns(lines, first, scale);
+  removedLineCount = size - output;
+  lines.truncate(output);
+}
+
+// The last output line is extended over the lines continuing it while its end can be dropped, so
+// a run is simplified in a single pass. Lines are written at or before the one being read.
+uint32_t EdgeSimplifier::simplifyRuns(Buffer<Line>& lines, const uint32_t first,
+                                      const float scale) {
+  float minLengthSquared = minLength * minLength / (scale * scale);
+  float maxDeviation = tolerance / scale;
+  float maxDeviationSquared = maxDeviation * maxDeviation;
+  uint32_t size = lines.getSize();
+  uint32_t output = first;
+  uint32_t start = first;
+
+  // Directions of the last output line that keep the vertices merged into it within the tolerance
+  Cone cone = {{0, 0}, {0, 0}};
+  bool hasCone = false;
+
+  for (uint32_t i = first; i < size; i++) {
+    Line line = lines[i];
+    if (output > start) {
+      Line& last = lines[output - 1];
+      if (isSamePoint(line.a, last.b) && line.brightness == last.brightness) {
+        // Collapse the end of the last line while it's shorter than the minimum length
+        Vector2 d = Vector2Subtract(last.b, last.a);
+        float lengthSquared = getLengthSquared(d);
+        if (lengthSquared < minLengthSquared) {
+          last.b = line.b;
+          continue;
+        }
+
+        // Merge the line into the last one if the merged line is longer, runs the same way and
+        // passes within the tolerance of the end of the last line. That's tested first, as it
+        // fails for most vertices, and then the vertices merged before it are tested with the cone.
+        Vector2 v = Vector2Subtract(line.b, last.a);
+        float mergedLengthSquared = getLengthSquared(v);
+        float deviation = cross(v, d);
+        if (mergedLengthSquared > lengthSquared && v.x * d.x + v.y * d.y > 0 &&
+            deviation * deviation <= maxDeviationSquared * mergedLengthSquared) {
+          narrowCone(cone, hasCone, d, lengthSquared, maxDeviation);
+          if (isInside(cone, hasCone, v)) {
+            last.b = line.b;
+            continue;
+          }
+        }
+
+        lines[output++] = line;
+        hasCone = false;
+        continue;
+      }
+      output = endRun(lines, first, start, output, minLengthSquared, &line.a);
+    }
+
+    start = output;
+    lines[output++] = line;
+    hasCone = false;
+  }
+
+  if (output > start) {
+    output = endRun(lines, first, start, output, minLengthSquared, nullptr);
+  }
+  return output;
+}
+
+// A last line shorter than the minimum length is merged into the previous one. A run that is
+// shorter altogether, or left with a single line repeating an earlier such run, is dropped unless
+// it links the line before it to the next one (if any). Lines within longer runs aren't tested for
+// repeats, as they can't be dropped without splitting the run, and repeats are rare among them.
+uint32_t EdgeSimplifier::endRun(Buffer<Line>& lines, const uint32_t first, const uint32_t start,
+                                const uint32_t output, const float minLengthSquared,
+                                const Vector2* next) {
+  const Line& last = lines[output - 1];
+  bool isShort = getLengthSquared(Vector2Subtract(last.b, last.a)) < minLengthSquared;
+  if (output - 1 > start) {
+    if (!isShort) {
+      return output;
+    }
+    lines[output - 2].b = last.b;
+    return output - 1;
+  }
+
+  bool isLinked = start > first && isSamePoint(lines[start - 1].b, last.a) && next != nullptr &&
+                  isSamePoint(*next, last.b);
+  if (isLinked) {
+    return output;
+  }
+  if (isShort) {
+    return output - 1;
+  }
+
+  // Slots hold the latest single line run with their hash, which may be stale or from an earlier
+  // call, so they're checked against the line
+  uint32_t slot = getHash(last) & (slots.getCapacity() - 1);
+  uint32_t index = slots[slot];
+  if (index >= first && index < start && isSameLine(lines[index], last)) {
+    return output - 1;
+  }
+  slots[slot] = start;
+  return output;
+}
@@ -0,0 +1,57 @@
+#ifndef VOLTAGE_EDGE_SIMPLIFIER_H_
+#define VOLTAGE_EDGE_SIMPLIFIER_H_
+
+#include "Array.h"
+#include "types.h"
+
+namespace voltage {
+
+// Simplifies projected edges in screen space, so that the lines of distant or finely subdivided
+// objects scale with their size on screen instead of with the complexity of the mesh.
+//
+// Transform3D passes the lines added for the objects of a frame. Connected runs of lines with the
+// same brightness are treated as polylines and simplified in a single pass: vertices closer than
+// the minimum length to the previous kept one are collapsed, and a vertex is merged away when the
+// merged line stays within the tolerance of it and of the vertices merged before it. Kept vertices
+// keep their position, and the ends of a run aren't moved, so the lines only get shorter and no
+// blanking jump is added. Runs shorter than the minimum length are dropped, and so are runs left
+// with a single line repeating an earlier one, unless they link the lines before and after them.
+class EdgeSimplifier {
+  static const uint32_t defaultMaxLines = 1000;
+
+  // Lengths in DAC steps
+  float minLength;
+  float tolerance;
+
+  // Index of the latest single line run for each hash of its endpoints
+  Array<uint32_t> slots;
+
+  uint32_t removedLineCount;
+
+ public:
+  // The hash table used to find repeated lines has a slot per line up to the maximum number of
+  // lines per call. Lines with the same hash replace each other, so beyond it fewer are found.
+  EdgeSimplifier(const float minLength = 1.0, const float tolerance = 0.5,
+                 const uint32_t maxLines = defaultMaxLines);
+
+  void setMinLength(const float minLength) { this->minLength = minLength; }
+  void setTolerance(const float tolerance) { this->tolerance = tolerance; }
+
+  // Simplify the lines from the first one to the end of the buffer in place. The scale converts
+  // viewport units to DAC steps.
+  void simplify(Buffer<Line>& lines, const uint32_t first, const float scale);
+
+  // Number of lines removed in the last call
+  uint32_t getRemovedLineCount() const { return removedLineCount; }
+
+ private:
+  uint32_t simplifyRuns(Buffer<Line>& lines, const uint32_t first, const float scale);
+
+  // End the run of lines from the start to the output, and return the new output
+  uint32_t endRun(Buffer<Line>& lines, const uint32_t first, const uint32_t start,
+                  const uint32_t output, const float minLengthSquared, const Vector2* next);
+};
+
+}  // namespace voltage
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include "FrameCache.h"
+
+using namespace voltage;
+
+FrameCache::FrameCache(const uint32_t capacity, const DualDACWriter& lineWriter,
+                       const SingleDACWriter* brightnessWriter)
+    : lineWriter(lineWriter),
+      brightnessWriter(brightnessWriter),
+      capacity(capacity),
+      size(0),
+      hash(0),
+      isValid(false),
+      isOverflowed(false),
+      hitCount(0),
+      missCount(0),
+      cacheLineWriter(*this),
+      cacheBrightnessWriter(*this) {
+  samples = new uint32_t[capacity];
+}
+
+FrameCache::~FrameCache() { delete[] samples; }
+
+bool FrameCache::replay(const uint64_t hash) {
+  if (!isValid || hash != this->hash) {
+    missCount++;
+    return false;
+  }
+
+  SampleStream::writeSamples(samples, size, lineWriter, brightnessWriter);
+  hitCount++;
+  return true;
+}
+
+void FrameCache::begin(const uint64_t hash) {
+  this->hash = hash;
+  size = 0;
+  isValid = false;
+  isOverflowed = false;
+}
+
+void FrameCache::end() { isValid = !isOverflowed; }
+
+void FrameCache::resetStatistics() {
+  hitCount = 0;
+  missCount = 0;
+}
@@ -0,0 +1,111 @@
+#ifndef VOLTAGE_FRAME_CACHE_H_
+#define VOLTAGE_FRAME_CACHE_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "SampleStream.h"
+#include "Writer.h"
+
+namespace voltage {
+
+// Samples of the last rendered frame.
+//
+// The renderer writes through the cache's writers, which pass the samples on to the actual DACs
+// and record them (packed like in SampleStream). When the next frame has the same lines, the
+// recorded samples are replayed instead of rasterizing the frame again. Frames exceeding the
+// capacity of the cache are drawn normally, but not cached.
+class FrameCache {
+ public:
+  class LineWriter final : public DualDACWriter {
+    FrameCache& cache;
+
+   public:
+    LineWriter(FrameCache& cache) : cache(cache) {}
+    uint32_t getMaxValue() const { return cache.lineWriter.getMaxValue(); }
+    void write(uint32_t a, uint32_t b) const {
+      cache.lineWriter.write(a, b);
+      cache.push(packSample(a, b));
+    }
+    void writeBatch(const uint32_t* samples, uint32_t count) const {
+      cache.lineWriter.writeBatch(samples, count);
+      cache.pushBatch(samples, count);
+    }
+  };
+
+  class BrightnessWriter final : public SingleDACWriter {
+    FrameCache& cache;
+
+   public:
+    BrightnessWriter(FrameCache& cache) : cache(cache) {}
+    uint32_t getMaxValue() const { return cache.brightnessWriter->getMaxValue(); }
+    void write(uint32_t value) const {
+      cache.brightnessWriter->write(value);
+      cache.push(value | SampleStream::brightnessFlag);
+    }
+  };
+
+ private:
+  const DualDACWriter& lineWriter;
+  const SingleDACWriter* brightnessWriter;
+  const uint32_t capacity;
+  uint32_t* samples;
+  uint32_t size;
+  uint64_t hash;
+  bool isValid;
+  bool isOverflowed;
+  uint32_t hitCount;
+  uint32_t missCount;
+
+  LineWriter cacheLineWriter;
+  BrightnessWriter cacheBrightnessWriter;
+
+ public:
+  // The capacity is given in samples, each taking four bytes
+  FrameCache(const uint32_t capacity, const DualDACWriter& lineWriter,
+             const SingleDACWriter* brightnessWriter = nullptr);
+  ~FrameCache();
+
+  DualDACWriter& getLineWriter() { return cacheLineWriter; }
+  SingleDACWriter* getBrightnessWriter() {
+    return brightnessWriter != nullptr ? &cacheBrightnessWriter : nullptr;
+  }
+
+  // Replays the cached frame if it was recorded for a frame with the given hash. Returns false
+  // otherwise, in which case the frame should be rendered and recorded between begin and end.
+  bool replay(const uint64_t hash);
+  void begin(const uint64_t hash);
+  void end();
+
+  // Drop the cached frame, e.g. after writing to the DACs outside the renderer
+  void invalidate() { isValid = false; }
+
+  uint32_t getHitCount() const { return hitCount; }
+  uint32_t getMissCount() const { return missCount; }
+  float getHitRate() const {
+    return hitCount + missCount > 0 ? hitCount / (float)(hitCount + missCount) : 0;
+  }
+  void resetStatistics();
+
+ private:
+  void push(const uint32_t sample) {
+    if (size < capacity) {
+      samples[size++] = sample;
+    } else {
+      isOverflowed = true;
+    }
+  }
+
+  void pushBatch(const uint32_t* batch, const uint32_t count) {
+    if (count <= capacity - size) {
+      std::copy(batch, batch + count, samples + size);
+      size += count;
+    } else {
+      isOverflowed = true;
+    }
+  }
+};
+
+}  // namespace voltage
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include <algorithm>
+
+#include "HiddenLineRemover.h"
+
+using namespace voltage;
+
+static inline float cross(const Vector2& a, const Vector2& b) { return a.x * b.y - a.y * b.x; }
+
+static inline Vector2 getMin(const Vector2& a, const Vector2& b) {
+  return {fminf(a.x, b.x), fminf(a.y, b.y)};
+}
+
+static inline Vector2 getMax(const Vector2& a, const Vector2& b) {
+  return {fmaxf(a.x, b.x), fmaxf(a.y, b.y)};
+}
+
+HiddenLineRemover::HiddenLineRemover(const uint32_t maxTriangles, const uint32_t maxLines)
+    : triangles(maxTriangles),
+      bounds(maxTriangles),
+      segments(maxLines),
+      visibleLines(maxLines * visibleLinesPerSegment),
+      cellStart(cellCount + 1),
+      cellSize(cellCount),
+      cellEntries(maxTriangles * 8),
+      intervals(maxIntervals),
+      query(0),
+      hiddenLineCount(0) {}
+
+void HiddenLineRemover::clear() {
+  triangles.clear();
+  bounds.clear();
+  segments.clear();
+  query = 0;
+}
+
+bool HiddenLineRemover::addSegment(const Line& line, const float aInverseDepth,
+                                   const float bInverseDepth, const Object* owner,
+                                   const int32_t faceA, const int32_t faceB) {
+  if (segments.getSize() == segments.getCapacity()) {
+    return false;
+  }
+  segments.push({line, {aInverseDepth, bInverseDepth}, owner, {faceA, faceB}});
+  return true;
+}
+
+void HiddenLineRemover::addTriangle(const Vector2* vertices, const float* inverseDepths,
+                                    const Object* owner, const int32_t face) {
+  // Degenerate triangles don't hide anything either
+  float area = cross(Vector2Subtract(vertices[1], vertices[0]),
+                     Vector2Subtract(vertices[2], vertices[0]));
+  if (triangles.getSize() == triangles.getCapacity() || fabsf(area) < 1e-9) {
+    return;
+  }
+
+  Triangle triangle;
+  TriangleBounds triangleBounds = {vertices[0], vertices[0], inverseDepths[0], 0};
+  for (uint32_t i = 0; i < 3; i++) {
+    triangle.vertices[i] = vertices[i];
+    triangle.inverseDepths[i] = inverseDepths[i];
+    triangleBounds.min = getMin(triangleBounds.min, vertices[i]);
+    triangleBounds.max = getMax(triangleBounds.max, vertices[i]);
+    triangleBounds.maxInverseDepth = fmaxf(triangleBounds.maxInverseDepth, inverseDepths[i]);
+  }
+  triangle.inverseArea = 1.0f / area;
+  triangle.owner = owner;
+  triangle.face = face;
+  triangles.push(triangle);
+  bounds.push(triangleBounds);
+}
+
+void HiddenLineRemover::removeHiddenLines(const Viewport& viewport) {
+  buildGrid(viewport);
+
+  visibleLines.clear();
+  hiddenLineCount = 0;
+  for (uint32_t i = 0; i < segments.getSize(); i++) {
+    // Keep room for at least one line for each of the remaining segments
+    uint32_t maxParts =
+        visibleLines.getCapacity() - visibleLines.getSize() - (segments.getSize() - i - 1);
+    addVisibleParts(segments[i], maxParts);
+  }
+}
+
+void HiddenLineRemover::buildGrid(const Viewport& viewport) {
+  origin = {viewport.left, viewport.bottom};
+  cellScale = {gridSize / (viewport.right - viewport.left),
+               gridSize / (viewport.top - viewport.bottom)};
+
+  // Counting sort the triangles by the cells their bounding boxes overlap
+  for (uint32_t i = 0; i < cellCount; i++) {
+    cellSize[i] = 0;
+  }
+
+  uint32_t x0, y0, x1, y1;
+  for (uint32_t i = 0; i < triangles.getSize(); i++) {
+    getCellRange(bounds[i].min, bounds[i].max, x0, y0, x1, y1);
+    for (uint32_t y = y0; y <= y1; y++) {
+      for (uint32_t x = x0; x <= x1; x++) {
+        cellSize[getCell(x, y)]++;
+      }
+    }
+  }
+
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < cellCount; i++) {
+    cellStart[i] = offset;
+    offset = std::min(offset + cellSize[i], (uint32_t)cellEntries.getCapacity());
+    cellSize[i] = 0;
+  }
+  cellStart[cellCount] = offset;
+
+  for (uint32_t i = 0; i < triangles.getSize(); i++) {
+    getCellRange(bounds[i].min, bounds[i].max, x0, y0, x1, y1);
+    for (uint32_t y = y0; y <= y1; y++) {
+      for (uint32_t x = x0; x <= x1; x++) {
+        uint32_t cell = getCell(x, y);
+        if (cellStart[cell] + cellSize[cell] < cellStart[cell + 1]) {
+          cellEntries[cellStart[cell] + cellSize[cell]++] = i;
+        }
+      }
+    }
+  }
+}
+
+void HiddenLineRemover::getCellRange(const Vector2& min, const Vector2& max, uint32_t& x0,
+                                     uint32_t& y0, uint32_t& x1, uint32_t& y1) const {
+  auto getIndex = [](const float value) -> uint32_t {
+    return fminf(fmaxf(value, 0), gridSize - 1);
+  };
+
+  x0 = getIndex((min.x - origin.x) * cellScale.x);
+  y0 = getIndex((min.y - origin.y) * cellScale.y);
+  x1 = getIndex((max.x - origin.x) * cellScale.x);
+  y1 = getIndex((max.y - origin.y) * cellScale.y);
+}
+
+// Barycentric weights and the inverse depth of the triangle are linear along the segment, so the
+// part of the segment inside the triangle and the part behind it are clipped like in Liang-Barsky
+void HiddenLineRemover::addHiddenInterval(const Segment& segment, const Triangle& triangle) {
+  const Vector2& a = segment.line.a;
+  const Vector2& b = segment.line.b;
+  const Vector2* v = triangle.vertices;
+
+  float t0 = 0;
+  float t1 = 1;
+  float depthA = 0;
+  float depthB = 0;
+
+  for (uint32_t i = 0; i < 3; i++) {
+    // Weight of vertex i is given by the edge opposite to it
+    const Vector2& p = v[(i + 1) % 3];
+    Vector2 edge = Vector2Subtract(v[(i + 2) % 3], p);
+    float weightA = cross(edge, Vector2Subtract(a, p)) * triangle.inverseArea;
+    float weightB = cross(edge, Vector2Subtract(b, p)) * triangle.inverseArea;
+
+    if (weightA < 0 && weightB < 0) {
+      return;
+    }
+    if (weightA < 0) {
+      float t = weightA / (weightA - weightB);
+      t0 = t > t0 ? t : t0;
+    } else if (weightB < 0) {
+      float t = weightA / (weightA - weightB);
+      t1 = t < t1 ? t : t1;
+    }
+
+    depthA += weightA * triangle.inverseDepths[i];
+    depthB += weightB * triangle.inverseDepths[i];
+  }
+
+  // The segment is behind where the triangle's inverse depth is larger
+  float differenceA = depthA - segment.inverseDepths[0] * (1 + depthTolerance);
+  float differenceB = depthB - segment.inverseDepths[1] * (1 + depthTolerance);
+
+  if (differenceA <= 0 && differenceB <= 0) {
+    return;
+  }
+  if (differenceA <= 0) {
+    float t = differenceA / (differenceA - differenceB);
+    t0 = t > t0 ? t : t0;
+  } else if (differenceB <= 0) {
+    float t = differenceA / (differenceA - differenceB);
+    t1 = t < t1 ? t : t1;
+  }
+
+  if (t0 < t1 && intervals.getSize() < intervals.getCapacity()) {
+    intervals.push({t0, t1});
+  }
+}
+
+bool HiddenLineRemover::isCovered() const {
+  // Extend the covered range from zero with the intervals starting within it until it reaches one
+  // or can't be extended anymore
+  float t = 0;
+  bool isExtended = true;
+  while (isExtended) {
+    isExtended = false;
+    for (uint32_t i = 0; i < intervals.getSize(); i++) {
+      if (intervals[i].a <= t && intervals[i].b > t) {
+        t = intervals[i].b;
+        isExtended = true;
+      }
+    }
+    if (t >= 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HiddenLineRemover::addVisibleParts(const Segment& segment, const uint32_t maxParts) {
+  const Line& line = segment.line;
+  Vector2 min = getMin(line.a, line.b);
+  Vector2 max = getMax(line.a, line.b);
+  float minInverseDepth =
+      fminf(segment.inverseDepths[0], segment.inverseDepths[1]) * (1 + depthTolerance);
+
+  // Each triangle is tested once, even if it's in several of the cells
+  query++;
+  intervals.clear();
+
+  uint32_t x0, y0, x1, y1;
+  getCellRange(min, max, x0, y0, x1, y1);
+  for (uint32_t y = y0; y <= y1; y++) {
+    for (uint32_t x = x0; x <= x1; x++) {
+      uint32_t cell = getCell(x, y);
+      for (uint32_t i = cellStart[cell]; i < cellStart[cell] + cellSize[cell]; i++) {
+        TriangleBounds& triangleBounds = bounds[cellEntries[i]];
+        if (triangleBounds.query == query) {
+          continue;
+        }
+        triangleBounds.query = query;
+
+        // Triangles completely behind the segment or outside its bounding box can't hide it
+        if (triangleBounds.maxInverseDepth <= minInverseDepth || triangleBounds.max.x < min.x ||
+            triangleBounds.min.x > max.x || triangleBounds.max.y < min.y ||
+            triangleBounds.min.y > max.y) {
+          continue;
+        }
+
+        const Triangle& triangle = triangles[cellEntries[i]];
+        bool isAdjacent = triangle.owner == segment.owner &&
+                          (triangle.face == segment.faces[0] || triangle.face == segment.faces[1]);
+        if (isAdjacent) {
+          continue;
+        }
+
+        // Stop testing once the whole segment is hidden
+        uint32_t intervalCount = intervals.getSize();
+        addHiddenInterval(segment, triangle);
+        if (intervals.getSize() > intervalCount && isCovered()) {
+          hiddenLineCount++;
+          return;
+        }
+      }
+    }
+  }
+
+  if (intervals.getSize() == 0) {
+    visibleLines.push(line);
+    return;
+  }
+
+  // Output the parts between the merged hidden intervals
+  std::sort(intervals.getElements(), intervals.getElements() + intervals.getSize(),
+            [](const Pair<float>& a, const Pair<float>& b) { return a.a < b.a; });
+
+  float length = Vector2Distance(line.a, line.b);
+  float minVisible = length > 0 ? minVisibleLength / length : 1;
+  uint32_t visibleCount = visibleLines.getSize();
+  float t = 0;
+
+  for (uint32_t i = 0; i <= intervals.getSize(); i++) {
+    float end = i < intervals.getSize() ? intervals[i].a : 1;
+    if (end - t > minVisible) {
+      // The segment is drawn as is if its parts don't fit
+      if (visibleLines.getSize() - visibleCount == maxParts) {
+        visibleLines.truncate(visibleCount);
+        visibleLines.push(line);
+        return;
+      }
+      visibleLines.push(
+          {Vector2Lerp(line.a, line.b, t), Vector2Lerp(line.a, line.b, end), line.brightness});
+    }
+    if (i < intervals.getSize()) {
+      t = fmaxf(t, intervals[i].b);
+    }
+  }
+
+  if (visibleLines.getSize() == visibleCount) {
+    hiddenLineCount++;
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef VOLTAGE_HIDDEN_LINE_REMOVER_H_
+#define VOLTAGE_HIDDEN_LINE_REMOVER_H_
+
+#include "Array.h"
+#include "Clipper.h"
+#include "types.h"
+
+namespace voltage {
+
+class Object;
+
+// Removes the parts of lines hidden behind front-facing faces of other objects (or other parts of
+// the same object).
+//
+// Transform3D adds the projected edges and the front-facing faces (split into triangles) of all
+// objects of a frame. The triangles are binned to a screen-space grid, and each edge is tested
+// against the triangles in the cells it overlaps. Within a triangle the inverse depth (1 / w) of
+// both the edge and the triangle is linear along the edge, so the hidden part of the edge is found
+// analytically, and only the visible sub-segments are output.
+class HiddenLineRemover {
+  static const uint32_t gridSize = 16;
+  static const uint32_t cellCount = gridSize * gridSize;
+  static const uint32_t maxIntervals = 64;
+
+  // Capacity of the visible lines per segment, as the segments can be split into several parts
+  static const uint32_t visibleLinesPerSegment = 2;
+
+  // Relative depth difference below which an edge isn't considered to be behind a triangle
+  const float depthTolerance = 1e-3;
+
+  // Visible parts shorter than this (in viewport units) are dropped
+  const float minVisibleLength = 0.002;
+
+  // Faces are indices to the mesh of the owner, edges aren't tested against their own faces
+  struct Triangle {
+    Vector2 vertices[3];
+    float inverseDepths[3];
+    float inverseArea;
+    const Object* owner;
+    int32_t face;
+  };
+
+  // Most of the triangles in the cells of a segment are rejected by their bounds, so these are
+  // stored apart from the triangles
+  struct TriangleBounds {
+    Vector2 min, max;
+    float maxInverseDepth;
+    uint32_t query;
+  };
+
+  struct Segment {
+    Line line;
+    float inverseDepths[2];
+    const Object* owner;
+    int32_t faces[2];
+  };
+
+  Buffer<Triangle> triangles;
+  Buffer<TriangleBounds> bounds;
+  Buffer<Segment> segments;
+  Buffer<Line> visibleLines;
+
+  // Triangles of each cell are stored contiguously. Cells that don't fit in the entries anymore
+  // are truncated.
+  Array<uint32_t> cellStart;
+  Array<uint32_t> cellSize;
+  Array<uint32_t> cellEntries;
+  Buffer<Pair<float>> intervals;
+
+  Vector2 origin;
+  Vector2 cellScale;
+  uint32_t query;
+  uint32_t hiddenLineCount;
+
+ public:
+  // Capacities for the triangles of the front-facing faces and the lines per frame
+  HiddenLineRemover(const uint32_t maxTriangles, const uint32_t maxLines);
+
+  void clear();
+
+  // Returns false if the segment didn't fit, in which case it should be drawn as is
+  bool addSegment(const Line& line, const float aInverseDepth, const float bInverseDepth,
+                  const Object* owner, const int32_t faceA, const int32_t faceB);
+
+  // Triangles that don't fit are ignored, i.e. they don't hide anything
+  void addTriangle(const Vector2* vertices, const float* inverseDepths, const Object* owner,
+                   const int32_t face);
+
+  // Compute the visible parts of the added segments
+  void removeHiddenLines(const Viewport& viewport);
+
+  const Buffer<Line>& getVisibleLines() const { return visibleLines; }
+
+  // Number of segments removed completely in the last frame
+  uint32_t getHiddenLineCount() const { return hiddenLineCount; }
+
+ private:
+  void buildGrid(const Viewport& viewport);
+  void getCellRange(const Vector2& min, const Vector2& max, uint32_t& x0, uint32_t& y0,
+                    uint32_t& x1, uint32_t& y1) const;
+  uint32_t getCell(const uint32_t x, const uint32_t y) const { return y * gridSize + x; }
+  void addHiddenInterval(const Segment& segment, const Triangle& triangle);
+  bool isCovered() const;
+
+  // Output at most the given number of parts, or the whole segment if there are more
+  void addVisibleParts(const Segment& segment, const uint32_t maxParts);
+};
+
+}  // namespace voltage
+
+#endif
@@ -8,35 +8,70 @@
 
 using namespace voltage;
 
+Mesh::Mesh(const MeshData& data)
+    : vertexCount(data.vertexCount),
+      edgeCount(data.edgeCount),
+      faceCount(data.faceCount),
+      vertices(data.vertices),
+      faceVertices(data.faceVertices),
+      faces(data.faces),
+      edges(data.edges),
+      boundingSphere(data.boundingSphere),
+      revision(nextRevision()),
+      ownedVertices(nullptr),
+      ownedFaceVertices(nullptr),
+      ownedFaces(nullptr),
+      ownedEdges(nullptr) {
+  countStrips();
+}
+
 Mesh::Mesh(const Vector3* vertices, const uint32_t vertexCount, const FaceDefinition* faces,
            const uint32_t faceCount) {
   setupVerticesAndFaces(vertices, vertexCount, faces, faceCount);
+  generateNormals();
+  calculateBoundingSphere();
+  generateEdges();
+  generateStrips();
+}
+
+Mesh::Mesh(const Vector3* vertices, const uint32_t vertexCount, const FaceDefinition* faces,
+           const uint32_t faceCount, const MeshCleanup& cleanup) {
+  setupVerticesAndFaces(vertices, vertexCount, faces, faceCount);
+  if (cleanup.weldDistance > 0) {
+    weldVertices(cleanup.weldDistance);
+  }
+  generateNormals();
+  calculateBoundingSphere();
   generateEdges();
-  addFaceToEdgePointers();
+  if (cleanup.coplanarAngle > 0) {
+    removeCoplanarEdges(cleanup.coplanarAngle);
+  }
+  generateStrips();
 }
 
 Mesh::Mesh(const Vector3* sourceVertices, const uint32_t sourceVertexCount,
            const FaceDefinition* sourceFaces, const uint32_t sourceFaceCount,
            const EdgeDefinition* sourceEdges, const uint32_t sourceEdgeCount) {
   setupVerticesAndFaces(sourceVertices, sourceVertexCount, sourceFaces, sourceFaceCount);
+  generateNormals();
+  calculateBoundingSphere();
 
   edgeCount = sourceEdgeCount;
-  edges = new Edge[edgeCount];
+  ownedEdges = new Edge[edgeCount];
+  edges = ownedEdges;
 
   for (uint32_t i = 0; i < sourceEdgeCount; i++) {
-    const EdgeDefinition& edge = sourceEdges[i];
-    edges[i].vertices = {&vertices[edge.vertexIndices.a], &vertices[edge.vertexIndices.b]};
-    edges[i].faces.a = edge.faceIndices.a > -1 ? &faces[edge.faceIndices.a] : nullptr;
-    edges[i].faces.b = edge.faceIndices.b > -1 ? &faces[edge.faceIndices.b] : nullptr;
+    ownedEdges[i] = {sourceEdges[i].vertexIndices, sourceEdges[i].faceIndices};
   }
 
-  addFaceToEdgePointers();
+  generateStrips();
 }
 
 Mesh::~Mesh() {
-  delete vertices;
-  delete edges;
-  delete faces;
+  delete[] ownedVertices;
+  delete[] ownedFaceVertices;
+  delete[] ownedFaces;
+  delete[] ownedEdges;
 }
 
 void Mesh::setupVerticesAndFaces(const Vector3* sourceVertices, const uint32_t sourceVertexCount,
@@ -45,100 +80,347 @@ void Mesh::setupVerticesAndFaces(const Vector3* sourceVertices, const uint32_t s
   vertexCount = sourceVertexCount;
   faceCount = sourceFaceCount;
 
-  vertices = new Vertex[vertexCount];
-  faces = new Face[faceCount];
-
-  for (uint32_t i = 0; i < sourceVertexCount; i++) {
-    vertices[i].original = sourceVertices[i];
+  uint32_t faceVertexCount = 0;
+  for (uint32_t i = 0; i < sourceFaceCount; i++) {
+    faceVertexCount += sourceFaces[i].vertexCount;
   }
+
+  ownedVertices = new Vector3[vertexCount];
+  ownedFaceVertices = new uint32_t[faceVertexCount];
+  ownedFaces = new Face[faceCount];
+  ownedEdges = nullptr;
+  vertices = ownedVertices;
+  faceVertices = ownedFaceVertices;
+  faces = ownedFaces;
+  edges = nullptr;
+
+  std::copy(sourceVertices, sourceVertices + sourceVertexCount, ownedVertices);
+
+  uint32_t firstVertex = 0;
   for (uint32_t i = 0; i < sourceFaceCount; i++) {
     const FaceDefinition& sourceFace = sourceFaces[i];
-    Face& face = faces[i];
+    ownedFaces[i].firstVertex = firstVertex;
+    ownedFaces[i].vertexCount = sourceFace.vertexCount;
+    std::copy(sourceFace.vertexIndices, sourceFace.vertexIndices + sourceFace.vertexCount,
+              ownedFaceVertices + firstVertex);
+    firstVertex += sourceFace.vertexCount;
+  }
+}
+
+// Vertices are binned to a grid with cells of the weld distance, which is hashed to an open table
+// of cell chains. A vertex is merged to the first earlier vertex within the distance in the 27
+// cells around it, so the first vertex of a cluster is kept and the order of the vertices doesn't
+// change.
+void Mesh::weldVertices(const float distance) {
+  const uint32_t none = UINT32_MAX;
+  const uint32_t welded = UINT32_MAX - 1;
+
+  uint32_t tableSize = 1;
+  while (tableSize < vertexCount * 2) {
+    tableSize <<= 1;
+  }
+  uint32_t* table = new uint32_t[tableSize];
+  std::fill(table, table + tableSize, none);
+  uint32_t* next = new uint32_t[vertexCount];
+  uint32_t* remap = new uint32_t[vertexCount];
+
+  auto getCell = [&](const float value) { return (int32_t)floorf(value / distance); };
+  auto hashCell = [&](const int32_t x, const int32_t y, const int32_t z) {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) &
+           (tableSize - 1);
+  };
+
+  uint32_t weldedCount = 0;
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    const Vector3& vertex = ownedVertices[i];
+    int32_t x = getCell(vertex.x), y = getCell(vertex.y), z = getCell(vertex.z);
+
+    // Chains may also contain vertices of other cells hashed to the same slot, which are skipped
+    // by the distance test
+    uint32_t match = none;
+    for (int32_t dz = -1; dz <= 1 && match == none; dz++) {
+      for (int32_t dy = -1; dy <= 1 && match == none; dy++) {
+        for (int32_t dx = -1; dx <= 1 && match == none; dx++) {
+          for (uint32_t j = table[hashCell(x + dx, y + dy, z + dz)]; j != none; j = next[j]) {
+            if (Vector3Distance(ownedVertices[j], vertex) <= distance) {
+              match = j;
+              break;
+            }
+          }
+        }
+      }
+    }
 
-    face.vertexCount = sourceFace.vertexCount;
-    face.vertices = new Vertex*[face.vertexCount];
+    if (match != none) {
+      remap[i] = remap[match];
+      next[i] = welded;
+      weldedCount++;
+    } else {
+      // The vertex is kept, compacted to its new index after the previously welded vertices
+      uint32_t slot = hashCell(x, y, z);
+      next[i] = table[slot];
+      table[slot] = i;
+      remap[i] = i - weldedCount;
+    }
+  }
 
-    for (uint32_t j = 0; j < sourceFace.vertexCount; j++) {
-      face.vertices[j] = &vertices[sourceFace.vertexIndices[j]];
+  // Move the kept vertices. Chains refer to the original indices, so they aren't used anymore.
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    if (next[i] != welded) {
+      ownedVertices[remap[i]] = ownedVertices[i];
     }
   }
+  vertexCount -= weldedCount;
 
-  generateNormals();
-  calculateBoundingSphere();
+  // Drop repeated vertices from the faces, and faces left without an area
+  uint32_t faceVertexCount = 0;
+  uint32_t newFaceCount = 0;
+  for (uint32_t i = 0; i < faceCount; i++) {
+    const Face& face = ownedFaces[i];
+    uint32_t firstVertex = faceVertexCount;
+    for (uint32_t j = 0; j < face.vertexCount; j++) {
+      uint32_t index = remap[ownedFaceVertices[face.firstVertex + j]];
+      if (faceVertexCount == firstVertex || ownedFaceVertices[faceVertexCount - 1] != index) {
+        ownedFaceVertices[faceVertexCount++] = index;
+      }
+    }
+    while (faceVertexCount - firstVertex > 1 &&
+           ownedFaceVertices[faceVertexCount - 1] == ownedFaceVertices[firstVertex]) {
+      faceVertexCount--;
+    }
+
+    if (faceVertexCount - firstVertex >= 3) {
+      ownedFaces[newFaceCount++] = {firstVertex, faceVertexCount - firstVertex, {0, 0, 0}};
+    } else {
+      faceVertexCount = firstVertex;
+    }
+  }
+  faceCount = newFaceCount;
+
+  delete[] table;
+  delete[] next;
+  delete[] remap;
 }
 
 void Mesh::scale(const float value) {
-  for (uint32_t i = 0; i < vertexCount; i++) {
-    vertices[i].original = Vector3Scale(vertices[i].original, value);
+  if (ownedVertices == nullptr) {
+    return;
   }
-}
 
-Edge* Mesh::findEdge(const Pair<Vertex*>& vertices, const Buffer<Edge>& edges) {
-  for (uint32_t i = 0; i < edges.getSize(); i++) {
-    Edge* edge = &edges[i];
-    if ((vertices.a == edge->vertices.a && vertices.b == edge->vertices.b) ||
-        (vertices.a == edge->vertices.b && vertices.b == edge->vertices.a)) {
-      return edge;
-    }
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    ownedVertices[i] = Vector3Scale(ownedVertices[i], value);
   }
-  return nullptr;
+  boundingSphere = {boundingSphere.x * value, boundingSphere.y * value, boundingSphere.z * value,
+                    boundingSphere.w * fabsf(value)};
+  revision = nextRevision();
 }
 
+// Edges shared by faces are looked up from an open addressing hash table keyed by the vertex
+// indices, so that the edges are generated in linear time
 void Mesh::generateEdges() {
-  Buffer<Edge> edgeBuffer(VOLTAGE_MESH_MAX_EDGES);
+  const uint32_t empty = UINT32_MAX;
+
+  uint32_t maxEdgeCount = 0;
   for (uint32_t i = 0; i < faceCount; i++) {
-    Face& face = faces[i];
+    maxEdgeCount += faces[i].vertexCount;
+  }
 
-    for (uint32_t j = 0; j < face.vertexCount; j++) {
-      Pair<Vertex*> edgeVertices = {face.vertices[j], face.vertices[(j + 1) % face.vertexCount]};
-      Edge* existingEdge = findEdge(edgeVertices, edgeBuffer);
+  uint32_t tableSize = 1;
+  while (tableSize < maxEdgeCount * 2) {
+    tableSize <<= 1;
+  }
+  uint32_t* table = new uint32_t[tableSize];
+  std::fill(table, table + tableSize, empty);
 
-      if (existingEdge != nullptr) {
-        existingEdge->faces.b = &face;
-      } else {
-        edgeBuffer.push({{edgeVertices.a, edgeVertices.b}, {&face, nullptr}});
+  Buffer<Edge> edgeBuffer(maxEdgeCount);
+  for (uint32_t i = 0; i < faceCount; i++) {
+    const Face& face = faces[i];
+
+    for (uint32_t j = 0; j < face.vertexCount; j++) {
+      Pair<uint32_t> edgeVertices = {getFaceVertex(face, j),
+                                     getFaceVertex(face, (j + 1) % face.vertexCount)};
+      uint32_t slot = hashEdge(edgeVertices.a, edgeVertices.b);
+
+      while (true) {
+        slot &= tableSize - 1;
+        if (table[slot] == empty) {
+          table[slot] = edgeBuffer.getSize();
+          edgeBuffer.push({edgeVertices, {(int32_t)i, -1}});
+          break;
+        }
+
+        Edge& edge = edgeBuffer[table[slot]];
+        if ((edgeVertices.a == edge.vertices.a && edgeVertices.b == edge.vertices.b) ||
+            (edgeVertices.a == edge.vertices.b && edgeVertices.b == edge.vertices.a)) {
+          edge.faces.b = (int32_t)i;
+          break;
+        }
+        slot++;
       }
     }
   }
 
-  edges = new Edge[edgeBuffer.getSize()];
+  ownedEdges = new Edge[edgeBuffer.getSize()];
+  edges = ownedEdges;
   edgeCount = edgeBuffer.getSize();
-  std::copy(edgeBuffer.getElements(), edgeBuffer.getElements() + edgeBuffer.getSize(), edges);
-}
+  std::copy(edgeBuffer.getElements(), edgeBuffer.getElements() + edgeBuffer.getSize(),
+            ownedEdges);
 
-void Mesh::generateNormals() {
-  for (uint32_t i = 0; i < faceCount; i++) {
-    Face& face = faces[i];
+  delete[] table;
+}
 
-    Vector3 a = Vector3Subtract(face.vertices[1]->original, face.vertices[0]->original);
-    Vector3 b = Vector3Subtract(face.vertices[2]->original, face.vertices[0]->original);
-    Vector3 normal = Vector3CrossProduct(a, b);
-    face.normal = Vector3Normalize(normal);
+// Edges between faces with nearly equal normals don't outline the shape, so they can be left out
+void Mesh::removeCoplanarEdges(const float angle) {
+  float minCosine = cosf(angle);
+  uint32_t newEdgeCount = 0;
+  for (uint32_t i = 0; i < edgeCount; i++) {
+    const Edge& edge = ownedEdges[i];
+    if (edge.faces.b < 0 || Vector3DotProduct(faces[edge.faces.a].normal,
+                                              faces[edge.faces.b].normal) < minCosine) {
+      ownedEdges[newEdgeCount++] = edge;
+    }
   }
+  edgeCount = newEdgeCount;
 }
 
-void Mesh::addFaceToEdgePointers() {
-  Buffer<Edge*> edgePointers(VOLTAGE_MESH_MAX_EDGES);
+// Order and orient the edges so that the edge array consists of the minimum number of strips,
+// i.e. runs of edges where each edge starts from the vertex the previous one ended to.
+// Odd-degree vertices are paired with virtual edges, which makes every vertex degree even, and
+// an Eulerian circuit of each connected component is found with Hierholzer's algorithm. Splitting
+// the circuits at the virtual edges yields the strips.
+// https://en.wikipedia.org/wiki/Eulerian_path#Hierholzer's_algorithm
+void Mesh::generateStrips() {
+  const uint32_t none = UINT32_MAX;
+
+  // Pair odd-degree vertices
+  uint32_t* degrees = new uint32_t[vertexCount]();
+  for (uint32_t i = 0; i < edgeCount; i++) {
+    degrees[edges[i].vertices.a]++;
+    degrees[edges[i].vertices.b]++;
+  }
 
-  for (uint32_t i = 0; i < faceCount; i++) {
-    Face& face = faces[i];
-    edgePointers.clear();
+  Buffer<Pair<uint32_t>> endpoints(edgeCount + vertexCount / 2);
+  for (uint32_t i = 0; i < edgeCount; i++) {
+    endpoints.push(edges[i].vertices);
+  }
+
+  uint32_t oddVertex = none;
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    if (degrees[i] % 2 == 1) {
+      if (oddVertex == none) {
+        oddVertex = i;
+      } else {
+        endpoints.push({oddVertex, i});
+        degrees[oddVertex]++;
+        degrees[i]++;
+        oddVertex = none;
+      }
+    }
+  }
+
+  // Build adjacency lists of both real and virtual edges
+  uint32_t totalEdgeCount = endpoints.getSize();
+  uint32_t* adjacencyStart = new uint32_t[vertexCount + 1];
+  uint32_t* adjacencyNext = new uint32_t[vertexCount];
+  uint32_t* adjacency = new uint32_t[totalEdgeCount * 2];
+  bool* isUsed = new bool[totalEdgeCount]();
+
+  adjacencyStart[0] = 0;
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    adjacencyStart[i + 1] = adjacencyStart[i] + degrees[i];
+    adjacencyNext[i] = adjacencyStart[i];
+  }
+  for (uint32_t i = 0; i < totalEdgeCount; i++) {
+    adjacency[adjacencyNext[endpoints[i].a]++] = i;
+    adjacency[adjacencyNext[endpoints[i].b]++] = i;
+  }
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    adjacencyNext[i] = adjacencyStart[i];
+  }
+
+  // Find a circuit for every connected component. The stack holds (vertex, arriving edge) pairs
+  // and the circuit (edge, starting vertex) pairs.
+  Buffer<Pair<uint32_t>> stack(totalEdgeCount + 1);
+  Buffer<Pair<uint32_t>> circuit(totalEdgeCount);
+  Edge* stripEdges = new Edge[edgeCount];
+  uint32_t stripEdgeCount = 0;
+
+  for (uint32_t start = 0; start < vertexCount; start++) {
+    stack.clear();
+    circuit.clear();
+    stack.push({start, none});
+
+    while (stack.getSize() > 0) {
+      uint32_t vertex = stack.getLast().a;
+      uint32_t& next = adjacencyNext[vertex];
+      while (next < adjacencyStart[vertex + 1] && isUsed[adjacency[next]]) {
+        next++;
+      }
 
-    for (uint32_t j = 0; j < edgeCount; j++) {
-      Edge& edge = edges[j];
+      if (next < adjacencyStart[vertex + 1]) {
+        uint32_t edge = adjacency[next++];
+        isUsed[edge] = true;
+        Pair<uint32_t>& ends = endpoints[edge];
+        stack.push({ends.a == vertex ? ends.b : ends.a, edge});
+      } else {
+        uint32_t edge = stack.getLast().b;
+        stack.pop();
+        if (edge != none) {
+          circuit.push({edge, vertex});
+        }
+      }
+    }
+
+    // Rotate the circuit to begin after a virtual edge, so that it is split only at virtual edges
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < circuit.getSize(); i++) {
+      if (circuit[i].a >= edgeCount) {
+        offset = i + 1;
+        break;
+      }
+    }
 
-      if (edge.faces.a == &face) {
-        edgePointers.push(&edge);
-      } else if (edge.faces.b == &face) {
-        edgePointers.push(&edge);
+    for (uint32_t i = 0; i < circuit.getSize(); i++) {
+      Pair<uint32_t>& step = circuit[(i + offset) % circuit.getSize()];
+      if (step.a < edgeCount) {
+        Edge edge = edges[step.a];
+        if (edge.vertices.a != step.b) {
+          std::swap(edge.vertices.a, edge.vertices.b);
+        }
+        stripEdges[stripEdgeCount++] = edge;
       }
     }
+  }
+
+  delete[] ownedEdges;
+  ownedEdges = stripEdges;
+  edges = stripEdges;
+  countStrips();
+
+  delete[] degrees;
+  delete[] adjacencyStart;
+  delete[] adjacencyNext;
+  delete[] adjacency;
+  delete[] isUsed;
+}
+
+void Mesh::generateNormals() {
+  for (uint32_t i = 0; i < faceCount; i++) {
+    Face& face = ownedFaces[i];
+    const Vector3& origin = vertices[getFaceVertex(face, 0)];
+
+    Vector3 a = Vector3Subtract(vertices[getFaceVertex(face, 1)], origin);
+    Vector3 b = Vector3Subtract(vertices[getFaceVertex(face, 2)], origin);
+    Vector3 normal = Vector3CrossProduct(a, b);
+    face.normal = Vector3Normalize(normal);
+  }
+}
 
-    face.edgeCount = edgePointers.getSize();
-    if (edgePointers.getSize() > 0) {
-      face.edges = new Edge*[edgePointers.getSize()];
-      std::copy(edgePointers.getElements(), edgePointers.getElements() + edgePointers.getSize(),
-                face.edges);
+void Mesh::countStrips() {
+  stripCount = 0;
+  for (uint32_t i = 0; i < edgeCount; i++) {
+    if (i == 0 || edges[i].vertices.a != edges[i - 1].vertices.b) {
+      stripCount++;
     }
   }
 }
@@ -150,12 +432,12 @@ void Mesh::calculateBoundingSphere() {
   // Calculate axis-aligned bounding box
   for (uint32_t i = 0; i < vertexCount; i++) {
     // TODO: Use Vector3Min/Max instead?
-    min.x = fminf(min.x, vertices[i].original.x);
-    max.x = fmaxf(max.x, vertices[i].original.x);
-    min.y = fminf(min.y, vertices[i].original.y);
-    max.y = fmaxf(max.y, vertices[i].original.y);
-    min.z = fminf(min.z, vertices[i].original.z);
-    max.z = fmaxf(max.z, vertices[i].original.z);
+    min.x = fminf(min.x, vertices[i].x);
+    max.x = fmaxf(max.x, vertices[i].x);
+    min.y = fminf(min.y, vertices[i].y);
+    max.y = fmaxf(max.y, vertices[i].y);
+    min.z = fminf(min.z, vertices[i].z);
+    max.z = fmaxf(max.z, vertices[i].z);
   }
 
   // Calculate center and radius of the sphere
@@ -163,8 +445,9 @@ void Mesh::calculateBoundingSphere() {
   Vector3 center = Vector3Midpoint(min, max);
 
   for (uint32_t i = 0; i < vertexCount; i++) {
-    r = fmaxf(r, Vector3Distance(vertices[i].original, center));
+    r = fmaxf(r, Vector3Distance(vertices[i], center));
   }
 
   boundingSphere = {center.x, center.y, center.z, r};
+  revision = nextRevision();
 }
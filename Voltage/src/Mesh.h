@@ -1,8 +1,6 @@
 #ifndef VOLTAGE_MESH_H_
 #define VOLTAGE_MESH_H_
 
-#define VOLTAGE_MESH_MAX_EDGES 1000
-
 #include <algorithm>
 #include <initializer_list>
 
@@ -12,47 +10,32 @@
 
 namespace voltage {
 
-class Vertex {
- public:
-  Vector3 original;
-  Vector4 transformed;
-  bool isVisible;
-
-  void perspectiveDivide() {
-    float div = 1.0 / transformed.w;
-    transformed.x *= div;
-    transformed.y *= div;
-    transformed.z *= div;
-  }
-};
-
+// Edges and faces refer to the vertices and faces of the mesh by index
 struct Edge {
-  Pair<Vertex*> vertices;
-  Pair<class Face*> faces;
-  Pair<Vertex*> clipped;
-  bool isVisible;
-  bool isCulled;
+  Pair<uint32_t> vertices;
+  // An edge can belong to one or two faces. The former case is denoted by setting the b index as -1
+  Pair<int32_t> faces;
 };
 
-class Face {
- public:
-  Vertex** vertices;
+// The vertex indices of a face are stored contiguously in the face vertex array of the mesh
+struct Face {
+  uint32_t firstVertex;
   uint32_t vertexCount;
-  Edge** edges;
-  uint32_t edgeCount;
   Vector3 normal;
-  bool isVisible;
-
-  float getNormalAngle(const Vector3& vector) {
-    Vector3 view = Vector3Subtract(vector, vertices[0]->original);
-    return Vector3DotProduct(view, normal);
-  }
+};
 
-  void setVerticesVisible(bool isVisible) {
-    for (uint32_t i = 0; i < vertexCount; i++) {
-      vertices[i]->isVisible = isVisible;
-    }
-  }
+// Immutable data of a mesh. It only consists of plain arrays, so it can be defined as const (or
+// constexpr) arrays, which stay in flash instead of being copied to RAM. The edges should be
+// ordered into strips (see Mesh::generateStrips) for drawing them with as few jumps as possible.
+struct MeshData {
+  const Vector3* vertices;
+  uint32_t vertexCount;
+  const uint32_t* faceVertices;
+  const Face* faces;
+  uint32_t faceCount;
+  const Edge* edges;
+  uint32_t edgeCount;
+  Vector4 boundingSphere;
 };
 
 class FaceDefinition {
@@ -77,47 +60,87 @@ class EdgeDefinition {
   Pair<int32_t> faceIndices;
 };
 
+// Optional cleanup of definitions with redundant geometry, e.g. from OBJ exports that repeat the
+// vertices shared by faces
+struct MeshCleanup {
+  // Vertices closer to each other than this are merged, zero disables welding. Faces left with
+  // less than three vertices are removed.
+  float weldDistance;
+  // Edges between faces whose normals differ less than this angle (in radians) are removed, e.g.
+  // the diagonals of triangulated quads. Zero keeps all edges.
+  float coplanarAngle;
+};
+
+// Meshes only hold the immutable vertices and topology. The per-frame results of transforming a
+// mesh are stored by Transform3D, so a mesh can be shared by any number of objects.
 class Mesh {
  public:
   uint32_t vertexCount;
   uint32_t edgeCount;
   uint32_t faceCount;
-  Vertex* vertices;
-  Edge* edges;
-  Face* faces;
+  uint32_t stripCount;
+  const Vector3* vertices;
+  const uint32_t* faceVertices;
+  const Face* faces;
+  const Edge* edges;
   Vector4 boundingSphere;
 
+  // Changes when the vertices are modified (see calculateBoundingSphere)
+  uint32_t revision;
+
+  // Refers to the arrays of the data without copying them, so they must outlive the mesh
+  Mesh(const MeshData& data);
+
+  // Copies the vertices and generates the topology in RAM
   Mesh(const Vector3* vertices, const uint32_t vertexCount, const FaceDefinition* faces,
        const uint32_t faceCount);
+  Mesh(const Vector3* vertices, const uint32_t vertexCount, const FaceDefinition* faces,
+       const uint32_t faceCount, const MeshCleanup& cleanup);
   Mesh(const Vector3* vertices, const uint32_t vertexCount, const FaceDefinition* faces,
        const uint32_t faceCount, const EdgeDefinition* edges, const uint32_t edgeCount);
 
+  Mesh(const Mesh&) = delete;
+  Mesh& operator=(const Mesh&) = delete;
   ~Mesh();
 
+  MeshData getData() const {
+    return {vertices, vertexCount, faceVertices, faces, faceCount, edges, edgeCount,
+            boundingSphere};
+  }
+
+  // Vertices of a mesh created from definitions can be modified, others return nullptr
+  Vector3* getWritableVertices() { return ownedVertices; }
+
+  // Only scales meshes with writable vertices
   void scale(const float value);
-  void transformVisibleVertices(const Matrix& matrix) {
-    for (uint32_t i = 0; i < vertexCount; i++) {
-      if (vertices[i].isVisible) {
-        Vector3& original = vertices[i].original;
-        vertices[i].transformed =
-            Vector4Transform({original.x, original.y, original.z, 1.0}, matrix);
-      }
-    }
+
+  // Should be called after modifying the vertices, for keeping the bounding sphere (used for
+  // frustum culling) and the revision up to date
+  void calculateBoundingSphere();
+
+  uint32_t getFaceVertex(const Face& face, const uint32_t index) const {
+    return faceVertices[face.firstVertex + index];
   }
-  void setVerticesVisible(bool isVisible) {
-    for (uint32_t i = 0; i < vertexCount; i++) {
-      vertices[i].isVisible = isVisible;
-    }
+  float getNormalAngle(const Face& face, const Vector3& point) const {
+    Vector3 view = Vector3Subtract(point, vertices[getFaceVertex(face, 0)]);
+    return Vector3DotProduct(view, face.normal);
   }
 
  private:
+  // Arrays allocated by the mesh itself, nullptr when referring to external data
+  Vector3* ownedVertices;
+  uint32_t* ownedFaceVertices;
+  Face* ownedFaces;
+  Edge* ownedEdges;
+
   void setupVerticesAndFaces(const Vector3* vertices, const uint32_t vertexCount,
                              const FaceDefinition* faces, const uint32_t faceCount);
-  Edge* findEdge(const Pair<Vertex*>& vertex, const Buffer<Edge>& edges);
+  void weldVertices(const float distance);
   void generateEdges();
+  void removeCoplanarEdges(const float angle);
+  void generateStrips();
   void generateNormals();
-  void addFaceToEdgePointers();
-  void calculateBoundingSphere();
+  void countStrips();
 };
 
 };  // namespace voltage
@@ -22,31 +22,44 @@ bool edgeEquals(const EdgeMidpoint& edge, const Pair<uint32_t>& vertices) {
          (edge.vertexIndices.a == vertices.b && edge.vertexIndices.b == vertices.a);
 }
 
-void addEdge(const EdgeMidpoint& edge, Buffer<EdgeMidpoint>& buffer) {
-  bool exists = false;
-  for (uint32_t i = 0; i < buffer.getSize(); i++) {
-    if (edgeEquals(edge, buffer[i].vertexIndices)) {
-      exists = true;
+// Open addressing hash table of the midpoints keyed by the edge vertex indices
+class MidpointCache {
+  static const uint32_t empty = UINT32_MAX;
+  uint32_t size;
+  EdgeMidpoint* midpoints;
+
+ public:
+  MidpointCache(const uint32_t edgeCount) : size(1) {
+    while (size < edgeCount * 2) {
+      size <<= 1;
+    }
+    midpoints = new EdgeMidpoint[size];
+    for (uint32_t i = 0; i < size; i++) {
+      midpoints[i].index = empty;
     }
   }
-
-  if (!exists) {
-    buffer.push(edge);
-  }
-}
-
-uint32_t getMidpoint(const Pair<uint32_t>& indices, Buffer<Vector3>& vertexBuffer,
-                     Buffer<EdgeMidpoint>& midpointBuffer) {
-  uint32_t* midpointIndex = 0;
-  for (uint32_t i = 0; i < midpointBuffer.getSize(); i++) {
-    if (edgeEquals(midpointBuffer[i], indices)) {
-      midpointIndex = &midpointBuffer[i].index;
-      break;
+  ~MidpointCache() { delete[] midpoints; }
+
+  // Return the slot of the edge, which is either the stored midpoint or an empty slot for it
+  EdgeMidpoint& find(const Pair<uint32_t>& indices) {
+    uint32_t slot = hashEdge(indices.a, indices.b);
+    while (true) {
+      slot &= size - 1;
+      if (midpoints[slot].index == empty || edgeEquals(midpoints[slot], indices)) {
+        return midpoints[slot];
+      }
+      slot++;
     }
   }
 
-  if (midpointIndex != 0) {
-    return *midpointIndex;
+  static bool isEmpty(const EdgeMidpoint& midpoint) { return midpoint.index == empty; }
+};
+
+uint32_t getMidpoint(const Pair<uint32_t>& indices, Buffer<Vector3>& vertexBuffer,
+                     MidpointCache& midpointCache) {
+  EdgeMidpoint& cached = midpointCache.find(indices);
+  if (!MidpointCache::isEmpty(cached)) {
+    return cached.index;
   }
 
   Vector3& a = vertexBuffer[indices.a];
@@ -56,7 +69,7 @@ uint32_t getMidpoint(const Pair<uint32_t>& indices, Buffer<Vector3>& vertexBuffe
   uint32_t index = vertexBuffer.getSize();
 
   vertexBuffer.push(Vector3Normalize(midpoint));
-  midpointBuffer.push({{indices.a, indices.b}, index});
+  cached = {{indices.a, indices.b}, index};
 
   return index;
 }
@@ -129,7 +142,7 @@ Mesh* MeshBuilder::createIcosphere(const float size, const uint32_t subdivisions
   Buffer<Vector3> vertexBuffer(vertexCount);
   Buffer<Triangle> sourceTriangles(triangleCount);
   Buffer<Triangle> targetTriangles(triangleCount);
-  Buffer<EdgeMidpoint> midpointBuffer(edgeCount);
+  MidpointCache midpointCache(edgeCount);
 
   for (uint32_t i = 0; i < icosahedronVertexCount; i++) {
     vertexBuffer.push(Vector3Normalize(icosahedronVertices[i]));
@@ -145,9 +158,9 @@ Mesh* MeshBuilder::createIcosphere(const float size, const uint32_t subdivisions
     for (uint32_t j = 0; j < sourceTriangles.getSize(); j++) {
       uint32_t* indices = sourceTriangles[j].vertexIndices;
 
-      uint32_t aIndex = getMidpoint({indices[0], indices[1]}, vertexBuffer, midpointBuffer);
-      uint32_t bIndex = getMidpoint({indices[1], indices[2]}, vertexBuffer, midpointBuffer);
-      uint32_t cIndex = getMidpoint({indices[2], indices[0]}, vertexBuffer, midpointBuffer);
+      uint32_t aIndex = getMidpoint({indices[0], indices[1]}, vertexBuffer, midpointCache);
+      uint32_t bIndex = getMidpoint({indices[1], indices[2]}, vertexBuffer, midpointCache);
+      uint32_t cIndex = getMidpoint({indices[2], indices[0]}, vertexBuffer, midpointCache);
 
       targetTriangles.push({indices[0], aIndex, cIndex});
       targetTriangles.push({indices[1], bIndex, aIndex});
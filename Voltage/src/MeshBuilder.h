@@ -1,6 +1,8 @@
 #ifndef VOLTAGE_MESH_BUILDER_H_
 #define VOLTAGE_MESH_BUILDER_H_
 
+#include <cstdint>
+
 namespace voltage {
 
 class Mesh;
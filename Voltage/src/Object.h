@@ -3,15 +3,35 @@
 
 #include "Mesh.h"
 #include "raymath.h"
+#include "utils.h"
 
 namespace voltage {
 
+class TransformCache;
+
 enum class Culling { Front, Back, None };
 enum class Shading { None, Hidden };
 
+// Everything the edges of a transformed object depend on, apart from the object's brightness
+struct TransformState {
+  uint32_t objectRevision, cameraRevision, viewportRevision, meshRevision;
+  Culling culling;
+  Shading shading;
+  bool hasOccluders;
+
+  bool operator==(const TransformState& other) const {
+    return objectRevision == other.objectRevision && cameraRevision == other.cameraRevision &&
+           viewportRevision == other.viewportRevision && meshRevision == other.meshRevision &&
+           culling == other.culling && shading == other.shading &&
+           hasOccluders == other.hasOccluders;
+  }
+};
+
 class Object {
  public:
   Mesh* mesh;
+
+  // Modify with the setters, so that the model matrix gets updated
   Vector3 rotation, translation, scaling;
   Matrix modelMatrix;
   Culling culling;
@@ -31,19 +51,58 @@ class Object {
 
   Object() : Object(nullptr) {}
 
-  void setRotation(float x, float y, float z) { rotation = {x, y, z}; }
-  void setTranslation(float x, float y, float z) { translation = {x, y, z}; }
-  void setScaling(float x, float y, float z) { scaling = {x, y, z}; }
-  void setScaling(float scale) { scaling = {scale, scale, scale}; }
+  void setRotation(float x, float y, float z) {
+    rotation = {x, y, z};
+    invalidate();
+  }
+  void setTranslation(float x, float y, float z) {
+    translation = {x, y, z};
+    invalidate();
+  }
+  void setScaling(float x, float y, float z) {
+    scaling = {x, y, z};
+    invalidate();
+  }
+  void setScaling(float scale) { setScaling(scale, scale, scale); }
+
+  // Keep the lines of the object between frames, so that they're reused while the object, camera
+  // and mesh don't change. Each object needs a cache of its own, nullptr disables caching.
+  void setTransformCache(TransformCache* transformCache) { this->transformCache = transformCache; }
 
   Matrix& getModelMatrix() {
-    Matrix scale = MatrixScale(scaling.x, scaling.y, scaling.z);
-    Matrix rotate = MatrixRotateXYZ(rotation);
-    Matrix translate = MatrixTranslate(translation.x, translation.y, translation.z);
-    modelMatrix = MatrixMultiply(MatrixMultiply(scale, rotate), translate);
+    if (isModelMatrixDirty) {
+      Matrix scale = MatrixScale(scaling.x, scaling.y, scaling.z);
+      Matrix rotate = MatrixRotateXYZ(rotation);
+      Matrix translate = MatrixTranslate(translation.x, translation.y, translation.z);
+      modelMatrix = MatrixMultiply(MatrixMultiply(scale, rotate), translate);
+      isModelMatrixDirty = false;
+    }
 
     return modelMatrix;
   }
+
+  // Changes whenever the rotation, translation or scaling changes
+  uint32_t getRevision() const { return revision; }
+
+ private:
+  friend class Transform3D;
+
+  bool isModelMatrixDirty = true;
+  uint32_t revision = 0;
+  TransformCache* transformCache = nullptr;
+
+  // Matrices combined with the camera's, reused by Transform3D while the object and the camera
+  // don't change
+  uint32_t modelViewObjectRevision = 0;
+  uint32_t modelViewCameraRevision = 0;
+  Matrix modelViewMatrix;
+  Matrix modelViewProjectionMatrix;
+  Vector3 cameraPosition;
+
+  void invalidate() {
+    isModelMatrixDirty = true;
+    revision = nextRevision();
+  }
 };
 
 }  // namespace voltage
@@ -0,0 +1,270 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include "PathOptimizer.h"
+
+using namespace voltage;
+
+// Beam travel is proportional to the number of steps along the major axis
+static inline float getDistance(const Vector2& a, const Vector2& b) {
+  return fmaxf(fabsf(a.x - b.x), fabsf(a.y - b.y));
+}
+
+PathOptimizer::PathOptimizer(const uint32_t maxLines)
+    : twoOptBudget(0),
+      jumpCost(defaultJumpCost),
+      statistics({0, 0, 0, 0}),
+      chainStarts(maxLines + 1),
+      orderedStarts(maxLines + 1),
+      chainCount(0),
+      cellStart(cellCount),
+      cellSize(cellCount),
+      cellEntries(maxLines * 2),
+      entryPositions(maxLines * 2),
+      endpointCells(maxLines * 2),
+      ordered(maxLines) {}
+
+void PathOptimizer::optimize(Buffer<Line>& lines, const Vector2& start, const Viewport& viewport) {
+  uint32_t lineCount = lines.getSize();
+  statistics.blankTravelBefore = getTravel(lines, start, statistics.blankJumpsBefore);
+
+  buildChains(lines);
+  buildGrid(lines, viewport);
+
+  // Greedily pick the closest remaining chain endpoint and draw its chain starting from it. When
+  // the chain following the current one in the input starts where it ended, it's picked first.
+  ordered.clear();
+  Vector2 position = start;
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < chainCount; i++) {
+    uint32_t endpoint;
+    if (next < chainCount && !isRemoved(next) && getEndpoint(lines, next * 2).x == position.x &&
+        getEndpoint(lines, next * 2).y == position.y) {
+      endpoint = next * 2;
+    } else {
+      endpoint = findNearest(lines, position);
+    }
+    uint32_t chain = endpoint >> 1;
+    removeChain(chain);
+    orderedStarts[i] = ordered.getSize();
+
+    if (endpoint & 1) {
+      for (uint32_t j = chainStarts[chain + 1]; j > chainStarts[chain]; j--) {
+        ordered.push({lines[j - 1].b, lines[j - 1].a, lines[j - 1].brightness});
+      }
+    } else {
+      for (uint32_t j = chainStarts[chain]; j < chainStarts[chain + 1]; j++) {
+        ordered.push(lines[j]);
+      }
+    }
+    position = ordered.getLast().b;
+    next = chain + 1;
+  }
+  orderedStarts[chainCount] = lineCount;
+
+  if (twoOptBudget > 0) {
+    refine(start);
+  }
+
+  // Keep the input order unless the new one is cheaper
+  statistics.blankTravelAfter = getTravel(ordered, start, statistics.blankJumpsAfter);
+  if (statistics.blankTravelAfter + statistics.blankJumpsAfter * jumpCost >=
+      statistics.blankTravelBefore + statistics.blankJumpsBefore * jumpCost) {
+    statistics.blankTravelAfter = statistics.blankTravelBefore;
+    statistics.blankJumpsAfter = statistics.blankJumpsBefore;
+    return;
+  }
+
+  lines.clear();
+  for (uint32_t i = 0; i < lineCount; i++) {
+    lines.push(ordered[i]);
+  }
+}
+
+void PathOptimizer::buildChains(const Buffer<Line>& lines) {
+  chainCount = 0;
+  for (uint32_t i = 0; i < lines.getSize(); i++) {
+    if (i == 0 || lines[i].a.x != lines[i - 1].b.x || lines[i].a.y != lines[i - 1].b.y) {
+      chainStarts[chainCount++] = i;
+    }
+  }
+  chainStarts[chainCount] = lines.getSize();
+}
+
+void PathOptimizer::buildGrid(const Buffer<Line>& lines, const Viewport& viewport) {
+  origin = {viewport.left, viewport.bottom};
+  cellScale = {gridSize / (viewport.right - viewport.left),
+               gridSize / (viewport.top - viewport.bottom)};
+  minCellSize = fminf(1.0 / cellScale.x, 1.0 / cellScale.y);
+
+  // Counting sort the endpoints by cell
+  for (uint32_t i = 0; i < cellCount; i++) {
+    cellSize[i] = 0;
+  }
+  for (uint32_t i = 0; i < chainCount * 2; i++) {
+    endpointCells[i] = getCell(getEndpoint(lines, i));
+    cellSize[endpointCells[i]]++;
+  }
+
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < cellCount; i++) {
+    cellStart[i] = offset;
+    offset += cellSize[i];
+    cellSize[i] = 0;
+  }
+  for (uint32_t i = 0; i < chainCount * 2; i++) {
+    uint32_t cell = endpointCells[i];
+    uint32_t position = cellStart[cell] + cellSize[cell]++;
+    cellEntries[position] = i;
+    entryPositions[i] = position;
+  }
+}
+
+const Vector2& PathOptimizer::getEndpoint(const Buffer<Line>& lines,
+                                         const uint32_t endpoint) const {
+  uint32_t chain = endpoint >> 1;
+  return endpoint & 1 ? lines[chainStarts[chain + 1] - 1].b : lines[chainStarts[chain]].a;
+}
+
+uint32_t PathOptimizer::getCell(const Vector2& point) const {
+  int32_t x = (point.x - origin.x) * cellScale.x;
+  int32_t y = (point.y - origin.y) * cellScale.y;
+  x = std::min(std::max(x, 0), (int32_t)gridSize - 1);
+  y = std::min(std::max(y, 0), (int32_t)gridSize - 1);
+  return y * gridSize + x;
+}
+
+void PathOptimizer::removeChain(const uint32_t chain) {
+  // Swap both endpoints with the last unvisited endpoint of their cell and shrink the cell
+  for (uint32_t endpoint = chain * 2; endpoint <= chain * 2 + 1; endpoint++) {
+    uint32_t cell = endpointCells[endpoint];
+    uint32_t position = entryPositions[endpoint];
+    uint32_t last = cellStart[cell] + --cellSize[cell];
+    uint32_t moved = cellEntries[last];
+
+    cellEntries[position] = moved;
+    entryPositions[moved] = position;
+    cellEntries[last] = endpoint;
+    entryPositions[endpoint] = last;
+  }
+}
+
+bool PathOptimizer::isRemoved(const uint32_t chain) const {
+  uint32_t cell = endpointCells[chain * 2];
+  return entryPositions[chain * 2] >= cellStart[cell] + cellSize[cell];
+}
+
+int32_t PathOptimizer::findNearest(const Buffer<Line>& lines, const Vector2& position) const {
+  uint32_t cell = getCell(position);
+  int32_t cx = cell % gridSize;
+  int32_t cy = cell / gridSize;
+
+  int32_t nearest = -1;
+  float nearestDistance = 0;
+
+  // Search rings of cells around the position until no closer endpoint can be found
+  for (int32_t r = 0; r < (int32_t)gridSize; r++) {
+    for (int32_t y = cy - r; y <= cy + r; y++) {
+      if (y < 0 || y >= (int32_t)gridSize) {
+        continue;
+      }
+      bool isEdgeRow = y == cy - r || y == cy + r;
+      int32_t step = isEdgeRow || r == 0 ? 1 : 2 * r;
+
+      for (int32_t x = cx - r; x <= cx + r; x += step) {
+        if (x < 0 || x >= (int32_t)gridSize) {
+          continue;
+        }
+        uint32_t c = y * gridSize + x;
+        for (uint32_t i = cellStart[c]; i < cellStart[c] + cellSize[c]; i++) {
+          uint32_t endpoint = cellEntries[i];
+          float distance = getDistance(position, getEndpoint(lines, endpoint));
+          if (nearest == -1 || distance < nearestDistance) {
+            nearest = endpoint;
+            nearestDistance = distance;
+          }
+        }
+      }
+    }
+
+    if (nearest != -1 && nearestDistance <= r * minCellSize) {
+      break;
+    }
+  }
+
+  return nearest;
+}
+
+float PathOptimizer::getJumpCost(const Vector2& a, const Vector2& b) const {
+  float distance = getDistance(a, b);
+  return distance > 0 ? distance + jumpCost : 0;
+}
+
+// 2-opt: reversing a run of chains (and flipping each of their lines) changes only the two jumps
+// at the ends of the run, so each candidate can be evaluated in constant time
+void PathOptimizer::refine(const Vector2& start) {
+  uint32_t begin = getMicros();
+  int32_t count = chainCount;
+  bool isImproved = true;
+
+  while (isImproved) {
+    isImproved = false;
+
+    for (int32_t i = -1; i < count - 1; i++) {
+      if (getMicros() - begin > twoOptBudget) {
+        return;
+      }
+
+      const Vector2 a = i < 0 ? start : ordered[orderedStarts[i + 1] - 1].b;
+      for (int32_t j = i + 1; j < count; j++) {
+        uint32_t first = orderedStarts[i + 1];
+        uint32_t end = orderedStarts[j + 1];
+        const Vector2& b = ordered[first].a;
+        const Vector2& c = ordered[end - 1].b;
+        float before = getJumpCost(a, b);
+        float after = getJumpCost(a, c);
+        if (j < count - 1) {
+          const Vector2& d = ordered[end].a;
+          before += getJumpCost(c, d);
+          after += getJumpCost(b, d);
+        }
+
+        if (after < before - 1e-6) {
+          for (int32_t k = first, l = end - 1; k <= l; k++, l--) {
+            std::swap(ordered[k], ordered[l]);
+            std::swap(ordered[k].a, ordered[k].b);
+            if (k != l) {
+              std::swap(ordered[l].a, ordered[l].b);
+            }
+          }
+
+          // A chain spanning [s, e) in the run now spans [first + end - e, first + end - s)
+          for (int32_t k = i + 2, l = j; k <= l; k++, l--) {
+            uint32_t startK = orderedStarts[k];
+            orderedStarts[k] = first + end - orderedStarts[l];
+            orderedStarts[l] = first + end - startK;
+          }
+          isImproved = true;
+        }
+      }
+    }
+  }
+}
+
+float PathOptimizer::getTravel(const Buffer<Line>& lines, const Vector2& start, uint32_t& jumps) {
+  float travel = 0;
+  Vector2 position = start;
+  jumps = 0;
+
+  for (uint32_t i = 0; i < lines.getSize(); i++) {
+    float distance = getDistance(position, lines[i].a);
+    if (distance > 0) {
+      travel += distance;
+      jumps++;
+    }
+    position = lines[i].b;
+  }
+
+  return travel;
+}
@@ -0,0 +1,82 @@
+#ifndef VOLTAGE_PATH_OPTIMIZER_H_
+#define VOLTAGE_PATH_OPTIMIZER_H_
+
+#include "Array.h"
+#include "Clipper.h"
+#include "types.h"
+
+namespace voltage {
+
+struct PathStatistics {
+  // Total distance the beam travels between lines and the number of such jumps.
+  // Distances are measured in viewport units along the major axis, matching rasterizer steps.
+  float blankTravelBefore, blankTravelAfter;
+  uint32_t blankJumpsBefore, blankJumpsAfter;
+};
+
+// Reorders lines and swaps their endpoints to minimize the beam travel between them.
+// Runs of connected lines in the input (like the edge strips of a mesh) are kept together as
+// chains, which are drawn forwards or backwards. A greedy nearest neighbour pass (using a spatial
+// hash of the chain endpoints) orders the chains, and an optional 2-opt pass refines the result
+// until a time budget is exhausted. Every jump costs a brightness ramp on top of its distance, so
+// the input order is kept if the result isn't cheaper.
+class PathOptimizer {
+  static const uint32_t gridSize = 32;
+  static const uint32_t cellCount = gridSize * gridSize;
+
+  // About the length of the blanking ramp of a bright line, in viewport units of travel
+  const float defaultJumpCost = 0.4;
+
+  uint32_t twoOptBudget;
+  float jumpCost;
+  PathStatistics statistics;
+
+  // Index of the first line of each chain in the input and in the ordered lines, followed by the
+  // line count
+  Array<uint32_t> chainStarts;
+  Array<uint32_t> orderedStarts;
+  uint32_t chainCount;
+
+  // Endpoints are identified by chain index * 2 + endpoint (0 for the start, 1 for the end).
+  // Endpoints of each cell are stored contiguously and unvisited ones are kept at the front.
+  Array<uint32_t> cellStart;
+  Array<uint32_t> cellSize;
+  Array<uint32_t> cellEntries;
+  Array<uint32_t> entryPositions;
+  Array<uint32_t> endpointCells;
+  Buffer<Line> ordered;
+
+  Vector2 origin;
+  Vector2 cellScale;
+  float minCellSize;
+
+ public:
+  PathOptimizer(const uint32_t maxLines);
+
+  // Set the time in microseconds the 2-opt pass may spend per frame (zero disables the pass)
+  void setTwoOptBudget(const uint32_t microseconds) { twoOptBudget = microseconds; }
+
+  // Set the cost of a jump on top of its distance, in viewport units
+  void setJumpCost(const float jumpCost) { this->jumpCost = jumpCost; }
+
+  // Reorder lines in place. Start is the position of the beam before the first line.
+  void optimize(Buffer<Line>& lines, const Vector2& start, const Viewport& viewport);
+
+  const PathStatistics& getStatistics() const { return statistics; }
+
+ private:
+  void buildChains(const Buffer<Line>& lines);
+  void buildGrid(const Buffer<Line>& lines, const Viewport& viewport);
+  const Vector2& getEndpoint(const Buffer<Line>& lines, const uint32_t endpoint) const;
+  uint32_t getCell(const Vector2& point) const;
+  void removeChain(const uint32_t chain);
+  bool isRemoved(const uint32_t chain) const;
+  int32_t findNearest(const Buffer<Line>& lines, const Vector2& position) const;
+  float getJumpCost(const Vector2& a, const Vector2& b) const;
+  void refine(const Vector2& start);
+  static float getTravel(const Buffer<Line>& lines, const Vector2& start, uint32_t& jumps);
+};
+
+}  // namespace voltage
+
+#endif
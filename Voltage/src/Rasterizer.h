@@ -1,26 +1,420 @@
 #ifndef VOLTAGE_RASTERIZER_H_
 #define VOLTAGE_RASTERIZER_H_
 
+#include <cstdlib>
+
+#include "Curve.h"
 #include "Writer.h"
 #include "raymath.h"
 
 namespace voltage {
 
-class Rasterizer {
-  const DualDACWriter& dacWriter;
+// Line stepping algorithms. All of them produce the same sample count and stay within one DAC
+// step of the Float implementation, so they can be swapped freely for performance.
+enum class LineAlgorithm { Float, FixedPoint, Bresenham };
+
+// Stages the samples of a line on the stack and writes them to the writer in batches. The batch is
+// flushed when the line is finished, so the order relative to other writers (e.g. brightness) is
+// preserved.
+template <typename Writer>
+class SampleBatch {
+  static const uint32_t capacity = 64;
+  const Writer& writer;
+  uint32_t samples[capacity];
+  uint32_t count;
+
+ public:
+  SampleBatch(const Writer& writer) : writer(writer), count(0) {}
+  ~SampleBatch() { flush(); }
+
+  inline void push(const uint32_t x, const uint32_t y) {
+    samples[count++] = packSample(x, y);
+    if (count == capacity) {
+      flush();
+    }
+  }
+
+  inline void flush() {
+    if (count > 0) {
+      writer.writeBatch(samples, count);
+      count = 0;
+    }
+  }
+};
+
+// Rasterizer writing the samples to a writer of the given type. With a final writer class (like
+// Final<Teensy36Writer>) the per-sample write calls are resolved at compile time and inlined,
+// whereas the Rasterizer typedef below calls any DualDACWriter through its vtable.
+template <typename Writer>
+class BasicRasterizer {
+  const Writer& dacWriter;
   const uint32_t scaleValueHalf;
+  LineAlgorithm lineAlgorithm;
 
  public:
-  Rasterizer(const DualDACWriter& dacWriter)
-      : dacWriter(dacWriter), scaleValueHalf((uint32_t)(dacWriter.getMaxValue() * 0.5)) {}
+  BasicRasterizer(const Writer& dacWriter, LineAlgorithm lineAlgorithm = LineAlgorithm::Float)
+      : dacWriter(dacWriter),
+        scaleValueHalf((uint32_t)(dacWriter.getMaxValue() * 0.5)),
+        lineAlgorithm(lineAlgorithm) {}
+
+  void setLineAlgorithm(LineAlgorithm lineAlgorithm) { this->lineAlgorithm = lineAlgorithm; }
+  LineAlgorithm getLineAlgorithm() const { return lineAlgorithm; }
+
+  // DAC steps per viewport unit
+  float getScale() const { return scaleValueHalf; }
 
   void drawPoint(const Vector2& point) const;
+
+  // Draw each point with the given number of samples, jumping between the points without drawing
+  // anything in between
+  void drawPoints(const Vector2* points, const uint32_t count, const uint32_t dwell = 1) const;
   void drawLine(const Vector2& a, const Vector2& b, const uint32_t increment = 1) const;
 
+  // Number of DAC steps along the major axis of a line. Drawing the line writes
+  // steps / increment + 1 samples.
+  uint32_t getSteps(const Vector2& a, const Vector2& b) const;
+
+  // Draw the curve over its parameter range with evenly spaced parameter values, so that the
+  // sample density follows the speed of the curve. Drawing the curve writes
+  // max(steps / increment, 1) + 1 samples, where steps is given by getCurveSteps.
+  void drawCurve(const Curve& curve, const uint32_t increment = 1) const;
+
+  // Length of a curve in DAC steps (along the major axis of each chord), approximated by a
+  // polyline of a fixed number of chords
+  uint32_t getCurveSteps(const Curve& curve) const;
+
  private:
-  inline uint32_t transform(float value) const;
+  static const uint32_t curveStepChords = 16;
+  static const uint32_t curveBlockSamples = 32;
+
+  uint32_t transform(float value) const;
+  static int32_t toFixedPoint(float value) { return (int32_t)(value * 65536); }
+  void pushCurveSample(SampleBatch<Writer>& batch, int32_t x, int32_t y, bool isClamped,
+                       int32_t maxValue) const;
+  void drawLineFloat(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t increment) const;
+  void drawLineFixedPoint(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                          uint32_t increment) const;
+  void drawLineBresenham(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                         uint32_t increment) const;
 };
 
+template <typename Writer>
+void BasicRasterizer<Writer>::drawPoint(const Vector2& point) const {
+  dacWriter.write(transform(point.x), transform(point.y));
+}
+
+template <typename Writer>
+void BasicRasterizer<Writer>::drawPoints(const Vector2* points, const uint32_t count,
+                                         const uint32_t dwell) const {
+  SampleBatch<Writer> batch(dacWriter);
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t x = transform(points[i].x);
+    uint32_t y = transform(points[i].y);
+    for (uint32_t j = 0; j < dwell; j++) {
+      batch.push(x, y);
+    }
+  }
+}
+
+template <typename Writer>
+void BasicRasterizer<Writer>::drawLine(const Vector2& a, const Vector2& b,
+                                       const uint32_t increment) const {
+  int32_t x0 = transform(a.x);
+  int32_t y0 = transform(a.y);
+  int32_t x1 = transform(b.x);
+  int32_t y1 = transform(b.y);
+
+  switch (lineAlgorithm) {
+    case LineAlgorithm::FixedPoint:
+      drawLineFixedPoint(x0, y0, x1, y1, increment);
+      break;
+    case LineAlgorithm::Bresenham:
+      drawLineBresenham(x0, y0, x1, y1, increment);
+      break;
+    default:
+      drawLineFloat(x0, y0, x1, y1, increment);
+      break;
+  }
+}
+
+template <typename Writer>
+uint32_t BasicRasterizer<Writer>::getSteps(const Vector2& a, const Vector2& b) const {
+  int32_t dx = abs((int32_t)transform(b.x) - (int32_t)transform(a.x));
+  int32_t dy = abs((int32_t)transform(b.y) - (int32_t)transform(a.y));
+  return dx > dy ? dx : dy;
+}
+
+// The chord vectors of an elliptical arc are rotated like its points, so only the first one is
+// evaluated with sine and cosine
+template <typename Writer>
+uint32_t BasicRasterizer<Writer>::getCurveSteps(const Curve& curve) const {
+  float steps = 0;
+  float dt = (curve.range.b - curve.range.a) / curveStepChords;
+
+  if (curve.type == CurveType::Ellipse) {
+    const Vector2* p = curve.points;
+    float c = cosf(curve.range.a + dt) - cosf(curve.range.a);
+    float s = sinf(curve.range.a + dt) - sinf(curve.range.a);
+    float cosStep = cosf(dt);
+    float sinStep = sinf(dt);
+    for (uint32_t i = 0; i < curveStepChords; i++) {
+      float x = p[1].x * c + p[2].x * s;
+      float y = p[1].y * c + p[2].y * s;
+      steps += fmaxf(fabsf(x), fabsf(y));
+      float next = c * cosStep - s * sinStep;
+      s = s * cosStep + c * sinStep;
+      c = next;
+    }
+    return (uint32_t)(steps * scaleValueHalf);
+  }
+
+  Vector2 previous = curve.getStart();
+  for (uint32_t i = 1; i <= curveStepChords; i++) {
+    Vector2 point = curve.getPoint(curve.range.a + dt * i);
+    steps += fmaxf(fabsf(point.x - previous.x), fabsf(point.y - previous.y));
+    previous = point;
+  }
+  return (uint32_t)(steps * scaleValueHalf);
+}
+
+// Curves are drawn in blocks of at most curveBlockSamples samples. The position and the tangent
+// are evaluated at the ends of each block, and the cubic Hermite segment between them is stepped
+// with forward differencing in 16.16 fixed point, i.e. three additions per coordinate and sample.
+// The segment matches a Bezier curve exactly, and an elliptical arc within a tenth of a DAC step,
+// as the blocks of an arc are shortened to keep its error (at most radius * angle^4 / 384) below
+// that. Rounding errors only accumulate within a block. Elliptical arcs rotate the (cos, sin) pair
+// by the block angle between the blocks. Both run in DAC coordinates, where the curves keep their
+// form as the transform is affine.
+template <typename Writer>
+void BasicRasterizer<Writer>::drawCurve(const Curve& curve, const uint32_t increment) const {
+  uint32_t segments = getCurveSteps(curve) / increment;
+  if (segments == 0) {
+    segments = 1;
+  }
+
+  bool isEllipse = curve.type == CurveType::Ellipse;
+  float h = (curve.range.b - curve.range.a) / segments;
+  float offset = scaleValueHalf;
+  bool isClamped = curve.isClipped;
+  int32_t maxValue = scaleValueHalf * 2;
+  SampleBatch<Writer> batch(dacWriter);
+
+  // Points (Bezier control points and the ellipse center) are offset to the DAC range, while the
+  // axis vectors of an ellipse are only scaled
+  Vector2 p[4];
+  for (uint32_t i = 0; i < 4; i++) {
+    bool isPoint = !isEllipse || i == 0;
+    p[i] = {curve.points[i].x * scaleValueHalf + (isPoint ? offset : 0),
+            curve.points[i].y * scaleValueHalf + (isPoint ? offset : 0)};
+  }
+
+  // Power basis a * t^3 + b * t^2 + c * t + d of a Bezier curve
+  Vector2 a = {-p[0].x + 3 * p[1].x - 3 * p[2].x + p[3].x,
+               -p[0].y + 3 * p[1].y - 3 * p[2].y + p[3].y};
+  Vector2 b = {3 * p[0].x - 6 * p[1].x + 3 * p[2].x, 3 * p[0].y - 6 * p[1].y + 3 * p[2].y};
+  Vector2 c = {3 * (p[1].x - p[0].x), 3 * (p[1].y - p[0].y)};
+
+  uint32_t blockSamples = curveBlockSamples;
+  float cosT = 0, sinT = 0, cosBlock = 0, sinBlock = 0;
+  if (isEllipse) {
+    float radius = sqrtf(p[1].x * p[1].x + p[1].y * p[1].y + p[2].x * p[2].x + p[2].y * p[2].y);
+    float maxAngle = sqrtf(sqrtf(38.4f / (radius > 1 ? radius : 1)));
+    float maxSamples = maxAngle / fabsf(h);
+    if (maxSamples < blockSamples) {
+      blockSamples = maxSamples > 1 ? (uint32_t)maxSamples : 1;
+    }
+    cosT = cosf(curve.range.a);
+    sinT = sinf(curve.range.a);
+    cosBlock = cosf(h * blockSamples);
+    sinBlock = sinf(h * blockSamples);
+  }
+
+  auto evaluate = [&](const float t, Vector2& point, Vector2& tangent) {
+    if (isEllipse) {
+      point = {p[0].x + p[1].x * cosT + p[2].x * sinT, p[0].y + p[1].y * cosT + p[2].y * sinT};
+      tangent = {p[2].x * cosT - p[1].x * sinT, p[2].y * cosT - p[1].y * sinT};
+    } else {
+      point = {((a.x * t + b.x) * t + c.x) * t + p[0].x, ((a.y * t + b.y) * t + c.y) * t + p[0].y};
+      tangent = {(3 * a.x * t + 2 * b.x) * t + c.x, (3 * a.y * t + 2 * b.y) * t + c.y};
+    }
+  };
+
+  Vector2 start, startTangent;
+  evaluate(curve.range.a, start, startTangent);
+
+  for (uint32_t i = 0; i < segments;) {
+    uint32_t count = segments - i < blockSamples ? segments - i : blockSamples;
+    i += count;
+
+    if (isEllipse && i == segments) {
+      cosT = cosf(curve.range.b);
+      sinT = sinf(curve.range.b);
+    } else if (isEllipse) {
+      float next = cosT * cosBlock - sinT * sinBlock;
+      sinT = sinT * cosBlock + cosT * sinBlock;
+      cosT = next;
+    }
+    Vector2 end, endTangent;
+    evaluate(curve.range.a + h * i, end, endTangent);
+
+    // Hermite segment in the power basis of u from zero to one, stepped by 1 / count
+    float span = h * count;
+    float du = 1.0f / count;
+    float du2 = du * du;
+    float du3 = du2 * du;
+    Vector2 t0 = Vector2Scale(startTangent, span);
+    Vector2 t1 = Vector2Scale(endTangent, span);
+    Vector2 ha = {2 * (start.x - end.x) + t0.x + t1.x, 2 * (start.y - end.y) + t0.y + t1.y};
+    Vector2 hb = {3 * (end.x - start.x) - 2 * t0.x - t1.x, 3 * (end.y - start.y) - 2 * t0.y - t1.y};
+
+    int32_t x = toFixedPoint(start.x);
+    int32_t y = toFixedPoint(start.y);
+    int32_t d1x = toFixedPoint(ha.x * du3 + hb.x * du2 + t0.x * du);
+    int32_t d1y = toFixedPoint(ha.y * du3 + hb.y * du2 + t0.y * du);
+    int32_t d2x = toFixedPoint(6 * ha.x * du3 + 2 * hb.x * du2);
+    int32_t d2y = toFixedPoint(6 * ha.y * du3 + 2 * hb.y * du2);
+    int32_t d3x = toFixedPoint(6 * ha.x * du3);
+    int32_t d3y = toFixedPoint(6 * ha.y * du3);
+
+    for (uint32_t j = 0; j < count; j++) {
+      pushCurveSample(batch, x >> 16, y >> 16, isClamped, maxValue);
+      x += d1x;
+      y += d1y;
+      d1x += d2x;
+      d1y += d2y;
+      d2x += d3x;
+      d2y += d3y;
+    }
+
+    start = end;
+    startTangent = endTangent;
+  }
+
+  pushCurveSample(batch, toFixedPoint(start.x) >> 16, toFixedPoint(start.y) >> 16, isClamped,
+                  maxValue);
+}
+
+// Parts cut at the viewport boundary may step slightly past it at the DAC range, so their samples
+// are clamped instead of wrapping around
+template <typename Writer>
+inline void BasicRasterizer<Writer>::pushCurveSample(SampleBatch<Writer>& batch, int32_t x,
+                                                     int32_t y, bool isClamped,
+                                                     int32_t maxValue) const {
+  if (isClamped) {
+    x = x < 0 ? 0 : (x > maxValue ? maxValue : x);
+    y = y < 0 ? 0 : (y > maxValue ? maxValue : y);
+  }
+  batch.push((uint32_t)x, (uint32_t)y);
+}
+
+// Draw a line with DDA line drawing algorithm (with increment feature added):
+// https://www.geeksforgeeks.org/dda-line-generation-algorithm-computer-graphics/
+template <typename Writer>
+void BasicRasterizer<Writer>::drawLineFloat(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                                            uint32_t increment) const {
+  float dx = x1 - x0;
+  float dy = y1 - y0;
+
+  int32_t steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+  float ix = dx / steps * increment;
+  float iy = dy / steps * increment;
+
+  float x = x0;
+  float y = y0;
+  SampleBatch<Writer> batch(dacWriter);
+
+  for (int32_t i = 0; i <= steps; i += increment) {
+    batch.push((uint32_t)x, (uint32_t)y);
+    x += ix;
+    y += iy;
+  }
+}
+
+// Same DDA as above, but with 16.16 fixed-point coordinates. 12-bit DAC values leave enough
+// headroom for the fractional part, and the integer part is extracted with a single shift.
+template <typename Writer>
+void BasicRasterizer<Writer>::drawLineFixedPoint(int32_t x0, int32_t y0, int32_t x1,
+                                                 int32_t y1, uint32_t increment) const {
+  int32_t dx = x1 - x0;
+  int32_t dy = y1 - y0;
+
+  int32_t steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+  if (steps == 0) {
+    dacWriter.write(x0, y0);
+    return;
+  }
+
+  int32_t ix = (dx * 65536) / steps * (int32_t)increment;
+  int32_t iy = (dy * 65536) / steps * (int32_t)increment;
+
+  int32_t x = x0 * 65536;
+  int32_t y = y0 * 65536;
+  SampleBatch<Writer> batch(dacWriter);
+
+  for (int32_t i = 0; i <= steps; i += increment) {
+    batch.push((uint32_t)(x >> 16), (uint32_t)(y >> 16));
+    x += ix;
+    y += iy;
+  }
+}
+
+// Bresenham's line algorithm with integer error term only. When increment is larger than one,
+// the minor axis is advanced by the whole and the fractional part of increment * slope at once.
+// https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
+template <typename Writer>
+void BasicRasterizer<Writer>::drawLineBresenham(int32_t x0, int32_t y0, int32_t x1,
+                                                int32_t y1, uint32_t increment) const {
+  int32_t dx = abs(x1 - x0);
+  int32_t dy = abs(y1 - y0);
+  int32_t sx = x0 < x1 ? 1 : -1;
+  int32_t sy = y0 < y1 ? 1 : -1;
+
+  bool xMajor = dx >= dy;
+  int32_t steps = xMajor ? dx : dy;
+  int32_t minorDelta = xMajor ? dy : dx;
+  if (steps == 0) {
+    dacWriter.write(x0, y0);
+    return;
+  }
+
+  // Major axis moves by increment, minor axis by quotient (+1 when the error term overflows)
+  int32_t majorStep = (int32_t)increment * (xMajor ? sx : sy);
+  int32_t minorQuotient = (int32_t)increment * minorDelta / steps;
+  int32_t minorRemainder = (int32_t)increment * minorDelta % steps;
+  int32_t minorSign = xMajor ? sy : sx;
+
+  int32_t major = xMajor ? x0 : y0;
+  int32_t minor = xMajor ? y0 : x0;
+  int32_t error = steps / 2;
+  SampleBatch<Writer> batch(dacWriter);
+
+  for (int32_t i = 0; i <= steps; i += increment) {
+    if (xMajor) {
+      batch.push(major, minor);
+    } else {
+      batch.push(minor, major);
+    }
+
+    major += majorStep;
+    minor += minorQuotient * minorSign;
+    error += minorRemainder;
+    if (error >= steps) {
+      error -= steps;
+      minor += minorSign;
+    }
+  }
+}
+
+template <typename Writer>
+inline uint32_t BasicRasterizer<Writer>::transform(float value) const {
+  return (uint32_t)(value * scaleValueHalf + scaleValueHalf);
+}
+
+typedef BasicRasterizer<DualDACWriter> Rasterizer;
+
+// The virtual writer variant is compiled once in Rasterizer.cpp
+extern template class BasicRasterizer<DualDACWriter>;
+
 }  // namespace voltage
 
 #endif
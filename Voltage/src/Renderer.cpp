@@ -2,20 +2,200 @@
 #include <Arduino.h>
 #endif
 
+#include <algorithm>
+#include <cstddef>
+
 #include "Renderer.h"
 #include "Timer.h"
 
 using namespace voltage;
 
-void Renderer::setViewport(const Viewport& viewport) { this->viewport = viewport; }
+void Renderer::setViewport(const Viewport& viewport) {
+  this->viewport = viewport;
+  viewportRevision = nextRevision();
+}
 
 void Renderer::setBlankingPoint(const Vector2& blankingPoint) {
   this->blankingPoint = blankingPoint;
 }
 
-void Renderer::clear() { lines.clear(); }
+void Renderer::setLineAlgorithm(LineAlgorithm lineAlgorithm) {
+  rasterizer.setLineAlgorithm(lineAlgorithm);
+}
+
+void Renderer::setPathOptimizer(PathOptimizer* pathOptimizer) {
+  this->pathOptimizer = pathOptimizer;
+}
+
+void Renderer::setHiddenLineRemover(HiddenLineRemover* hiddenLineRemover) {
+  transform3D.setHiddenLineRemover(hiddenLineRemover);
+}
+
+void Renderer::setEdgeSimplifier(EdgeSimplifier* edgeSimplifier) {
+  transform3D.setEdgeSimplifier(edgeSimplifier);
+}
+
+void Renderer::setSampleBudget(uint32_t sampleBudget) { this->sampleBudget = sampleBudget; }
+
+void Renderer::setRefreshRate(float refreshRate) {
+  this->refreshRate = refreshRate;
+  lastFrameMicros = 0;
+}
+
+void Renderer::clear() {
+  lines.clear();
+  curves.clear();
+  strips.clear();
+  stripVertices.clear();
+  pointBatches.clear();
+  points.clear();
+}
+
+// The levels are accumulated exactly like in the interpolation loop, so that replaying the ramp
+// writes the same values
+void Renderer::createBlankingRamp() {
+  if (brightnessTransform == nullptr) {
+    return;
+  }
+
+  for (float z = 0; z < 1.0; z += blankingBrightnessIncrement) {
+    blankingRampSize++;
+  }
+
+  blankingRampLevels = new float[blankingRampSize];
+  blankingRamp = new uint32_t[blankingRampSize];
+  float z = 0;
+  for (uint32_t i = 0; i < blankingRampSize; i++) {
+    blankingRampLevels[i] = z;
+    blankingRamp[i] = brightnessTransform->transform(z);
+    z += blankingBrightnessIncrement;
+  }
+}
+
+int32_t Renderer::getBlankingRampLength(float brightness) const {
+  if (blankingRamp == nullptr || brightness > 1.0) {
+    return -1;
+  }
+  return std::lower_bound(blankingRampLevels, blankingRampLevels + blankingRampSize, brightness) -
+         blankingRampLevels;
+}
+
+void Renderer::rasterizeLines() {
+  rasterizeLines(rasterizer, brightnessWriter, brightnessTransform);
+}
+
+// 2D lines are clipped to the viewport when added, 3D lines are clipped in clip space already
+void Renderer::add(const Line& line) {
+  Vector2 a = line.a;
+  Vector2 b = line.b;
+  if (clipLine(a, b, viewport)) {
+    lines.push({a, b, line.brightness});
+  }
+}
+
+void Renderer::addClipped(const Line& line) {
+  if (lines.getSize() < lines.getCapacity()) {
+    lines.push(line);
+  }
+}
+
+void Renderer::addPolyline(const Vector2* vertices, const uint32_t vertexCount,
+                           const float brightness) {
+  addStrip(vertices, vertexCount, false, brightness);
+}
+
+void Renderer::addLoop(const Vector2* vertices, const uint32_t vertexCount,
+                       const float brightness) {
+  addStrip(vertices, vertexCount, true, brightness);
+}
+
+// A strip continues while the segments stay inside the viewport. A segment clipped at its start
+// begins a new strip, and one clipped at its end finishes the current one.
+void Renderer::addStrip(const Vector2* vertices, const uint32_t vertexCount, const bool isClosed,
+                        const float brightness) {
+  if (vertexCount < 2) {
+    return;
+  }
+
+  uint32_t segmentCount = isClosed && vertexCount > 2 ? vertexCount : vertexCount - 1;
+  bool isOpen = false;
+
+  for (uint32_t i = 0; i < segmentCount; i++) {
+    const Vector2& start = vertices[i];
+    const Vector2& end = vertices[i + 1 < vertexCount ? i + 1 : 0];
+
+    // The start of an open strip is inside, so a segment ending inside needs no clipping
+    if (isOpen && isInside(end, viewport)) {
+      if (stripVertices.getSize() == stripVertices.getCapacity()) {
+        return;
+      }
+      stripVertices.push(end);
+      strips.getLast().vertexCount++;
+      continue;
+    }
+
+    Vector2 a = start;
+    Vector2 b = end;
+    if (!clipLine(a, b, viewport)) {
+      isOpen = false;
+      continue;
+    }
 
-void Renderer::add(const Line& line) { lines.push(line); }
+    bool isAClipped = a.x != start.x || a.y != start.y;
+    if (!isOpen || isAClipped) {
+      if (stripVertices.getSize() + 2 > stripVertices.getCapacity() ||
+          strips.getSize() == strips.getCapacity()) {
+        return;
+      }
+      strips.push({stripVertices.getSize(), 1, brightness});
+      stripVertices.push(a);
+    } else if (stripVertices.getSize() == stripVertices.getCapacity()) {
+      return;
+    }
+
+    stripVertices.push(b);
+    strips.getLast().vertexCount++;
+    isOpen = b.x == end.x && b.y == end.y;
+  }
+}
+
+void Renderer::addPoints(const Vector2* points, const uint32_t count, const float brightness,
+                         const uint32_t dwell) {
+  for (uint32_t i = 0; i < count && this->points.getSize() < this->points.getCapacity(); i++) {
+    if (!isInside(points[i], viewport)) {
+      continue;
+    }
+
+    PointBatch* batch = pointBatches.getSize() > 0 ? &pointBatches.getLast() : nullptr;
+    if (batch == nullptr || batch->brightness != brightness || batch->dwell != dwell ||
+        batch->pointCount == maxBatchPoints) {
+      if (pointBatches.getSize() == pointBatches.getCapacity()) {
+        return;
+      }
+      pointBatches.push({this->points.getSize(), 0, brightness, dwell});
+      batch = &pointBatches.getLast();
+    }
+
+    this->points.push(points[i]);
+    batch->pointCount++;
+  }
+}
+
+void Renderer::addArc(const Arc& arc) { addCurve(Curve::fromArc(arc)); }
+
+void Renderer::addEllipse(const Ellipse& ellipse) { addCurve(Curve::fromEllipse(ellipse)); }
+
+void Renderer::addBezier(const QuadraticBezier& bezier) { addCurve(Curve::fromBezier(bezier)); }
+
+void Renderer::addBezier(const CubicBezier& bezier) { addCurve(Curve::fromBezier(bezier)); }
+
+void Renderer::addCurve(const Curve& curve) {
+  Curve parts[maxCurveParts];
+  uint32_t partCount = clipCurve(curve, viewport, parts, maxCurveParts);
+  for (uint32_t i = 0; i < partCount && curves.getSize() < curves.getCapacity(); i++) {
+    curves.push(parts[i]);
+  }
+}
 
 void Renderer::add(Object* object, Camera& camera) {
   static Array<Object*> objects(1);
@@ -40,51 +220,290 @@ void Renderer::addViewport() {
   }
 }
 
-TIMER_CREATE(viewportClip);
-TIMER_CREATE(rasterize);
+// Spread the lower 8 bits of the value to the even bits of the result
+static inline uint32_t spreadBits(uint32_t value) {
+  value &= 0xFF;
+  value = (value | (value << 4)) & 0x0F0F;
+  value = (value | (value << 2)) & 0x3333;
+  value = (value | (value << 1)) & 0x5555;
+  return value;
+}
 
-void Renderer::render() {
-  TIMER_START(viewportClip);
-  clippedLines.clear();
+// The Morton code of a point interleaves the bits of its position on a 256 x 256 grid over the
+// viewport, so sorting by it visits the cells in Z-order, where most steps are to a neighbouring
+// cell. The keys are sorted with a two-pass radix sort (stable, so points in the same cell keep
+// their order), and the points are then permuted in place by following the cycles of the order.
+void Renderer::orderPoints() {
+  const uint32_t done = UINT32_MAX;
+  float scaleX = 255.0f / (viewport.right - viewport.left);
+  float scaleY = 255.0f / (viewport.top - viewport.bottom);
+
+  for (uint32_t i = 0; i < pointBatches.getSize(); i++) {
+    const PointBatch& batch = pointBatches[i];
+    Vector2* batchPoints = &points[batch.firstPoint];
+    uint32_t* keys = &pointOrder[batch.firstPoint];
+    uint32_t* scratch = &pointOrderScratch[batch.firstPoint];
+
+    // Points were culled against the viewport when they were added, which may have changed since
+    for (uint32_t j = 0; j < batch.pointCount; j++) {
+      uint32_t x = fminf(fmaxf((batchPoints[j].x - viewport.left) * scaleX, 0), 255);
+      uint32_t y = fminf(fmaxf((batchPoints[j].y - viewport.bottom) * scaleY, 0), 255);
+      keys[j] = (spreadBits(x) | spreadBits(y) << 1) << 16 | j;
+    }
+
+    uint32_t* source = keys;
+    uint32_t* target = scratch;
+    for (uint32_t shift = 16; shift < 32; shift += 8) {
+      uint32_t offsets[256] = {0};
+      for (uint32_t j = 0; j < batch.pointCount; j++) {
+        offsets[(source[j] >> shift) & 0xFF]++;
+      }
+      uint32_t offset = 0;
+      for (uint32_t j = 0; j < 256; j++) {
+        uint32_t count = offsets[j];
+        offsets[j] = offset;
+        offset += count;
+      }
+      for (uint32_t j = 0; j < batch.pointCount; j++) {
+        target[offsets[(source[j] >> shift) & 0xFF]++] = source[j];
+      }
+      std::swap(source, target);
+    }
+
+    // Point j of the ordered batch is the point at the index in the lower half word of key j
+    for (uint32_t j = 0; j < batch.pointCount; j++) {
+      if (source[j] == done) {
+        continue;
+      }
+
+      Vector2 first = batchPoints[j];
+      uint32_t k = j;
+      while ((source[k] & 0xFFFF) != j) {
+        uint32_t next = source[k] & 0xFFFF;
+        batchPoints[k] = batchPoints[next];
+        source[k] = done;
+        k = next;
+      }
+      batchPoints[k] = first;
+      source[k] = done;
+    }
+  }
+}
+
+uint32_t Renderer::getPointSampleCount() const {
+  // With a brightness writer each point gets an extra sample for the jump
+  uint32_t jumpSamples = brightnessWriter != nullptr ? 1 : 0;
+  uint32_t sampleCount = 0;
+  for (uint32_t i = 0; i < pointBatches.getSize(); i++) {
+    sampleCount += pointBatches[i].pointCount * (pointBatches[i].dwell + jumpSamples);
+  }
+  return sampleCount;
+}
+
+// Lines, strips and curves get samples in proportion to their brightness and length. The constant
+// term gives short lines more samples per step than long ones.
+static const uint32_t shortLineSteps = 64;
+static const float minBrightnessWeight = 0.1;
+
+static inline float getLineWeight(const float brightness, const uint32_t steps) {
+  return fmaxf(brightness, minBrightnessWeight) * (steps + shortLineSteps);
+}
+
+// Sampling the lines in proportion to their weights gives each line
+// steps / increment = budget * weight / weightSum samples (plus one for the starting point), i.e.
+// increment = steps * scale / weight, where scale = weightSum / budget. Returns zero if the lines
+// fit in the budget with the renderer's increment.
+float Renderer::getIncrementScale() {
+  if (sampleBudget == 0) {
+    return 0;
+  }
+
+  uint32_t sampleCount = 0;
+  float weightSum = 0;
   for (uint32_t i = 0; i < lines.getSize(); i++) {
-    Line line = lines[i];
-    Vector2 a = line.a;
-    Vector2 b = line.b;
-    if (clipLine(a, b, viewport)) {
-      clippedLines.push({a, b, lines[i].brightness});
+    uint32_t steps = rasterizer.getSteps(lines[i].a, lines[i].b);
+    sampleCount += steps / increment + 1;
+    weightSum += getLineWeight(lines[i].brightness, steps);
+  }
+  for (uint32_t i = 0; i < strips.getSize(); i++) {
+    const Vector2* vertices = &stripVertices[strips[i].firstVertex];
+    for (uint32_t j = 0; j + 1 < strips[i].vertexCount; j++) {
+      uint32_t steps = rasterizer.getSteps(vertices[j], vertices[j + 1]);
+      sampleCount += steps / increment + 1;
+      weightSum += getLineWeight(strips[i].brightness, steps);
     }
   }
-  TIMER_STOP(viewportClip);
+  for (uint32_t i = 0; i < curves.getSize(); i++) {
+    uint32_t steps = rasterizer.getCurveSteps(curves[i]);
+    sampleCount += std::max(steps / increment, 1u) + 1;
+    weightSum += getLineWeight(curves[i].brightness, steps);
+  }
 
-  TIMER_START(rasterize);
-  for (uint32_t i = 0; i < clippedLines.getSize(); i++) {
-    // Turn off beam and move it to the next position to be drawn
-    if (brightnessWriter != nullptr &&
-        (beamPosition.x != clippedLines[i].a.x || beamPosition.y != clippedLines[i].a.y)) {
-      brightnessWriter->write(brightnessTransform->transform(0));
-      rasterizer.drawLine(beamPosition, clippedLines[i].a, blankingDrawIncrement);
-
-      // Interpolate brightness in order to avoid aliasing artifacts
-      for (float z = 0; z < clippedLines[i].brightness; z += blankingBrightnessIncrement) {
-        rasterizer.drawPoint(clippedLines[i].a);
-        brightnessWriter->write(brightnessTransform->transform(z));
-      }
-      brightnessWriter->write(brightnessTransform->transform(clippedLines[i].brightness));
+  uint32_t pointSampleCount = getPointSampleCount();
+  if (sampleCount + pointSampleCount <= sampleBudget) {
+    return 0;
+  }
+
+  uint32_t fixedCount = lines.getSize() + getStripLineCount() + curves.getSize() + pointSampleCount;
+  float availableSamples = sampleBudget > fixedCount ? sampleBudget - fixedCount : 1;
+  return weightSum / availableSamples;
+}
+
+uint32_t Renderer::getLineIncrement(float brightness, uint32_t steps,
+                                    float incrementScale) const {
+  if (incrementScale == 0) {
+    return increment;
+  }
+
+  uint32_t lineIncrement = steps * incrementScale / getLineWeight(brightness, steps) + 0.5;
+  if (lineIncrement < increment) {
+    return increment;
+  }
+  if (lineIncrement > maxLineIncrement) {
+    return maxLineIncrement;
+  }
+  return lineIncrement;
+}
+
+// Frame time consists of rasterization, which is proportional to the sample count, and of the rest
+// (transform, application logic etc.), which is assumed to stay the same in the next frame
+void Renderer::updateSampleBudget(uint32_t sampleCount, uint32_t rasterizeMicros) {
+  uint32_t now = getMicros();
+
+  if (lastFrameMicros != 0 && sampleCount > 0 && rasterizeMicros > 0) {
+    float frameMicros = now - lastFrameMicros;
+    float microsPerSample = rasterizeMicros / (float)sampleCount;
+    float otherMicros = fmaxf(frameMicros - rasterizeMicros, 0);
+    float budget = (1e6 / refreshRate - otherMicros) / microsPerSample;
+    budget = fmaxf(budget, lines.getSize() + getStripLineCount() + curves.getSize() +
+                               getPointSampleCount() + 1);
+
+    sampleBudget = sampleBudget == 0
+                       ? budget
+                       : sampleBudget + (budget - sampleBudget) * sampleBudgetSmoothing;
+  }
+
+  lastFrameMicros = now;
+}
+
+// FNV-1a over the 32-bit words of the state and the primitives
+uint64_t Renderer::getFrameHash() const {
+  const uint64_t prime = 1099511628211ull;
+  uint64_t hash = 14695981039346656037ull;
+
+  auto add = [&](const void* data, const uint32_t size) {
+    const uint32_t* words = (const uint32_t*)data;
+    for (uint32_t i = 0; i < size / sizeof(uint32_t); i++) {
+      hash = (hash ^ words[i]) * prime;
     }
+  };
 
-    rasterizer.drawLine(clippedLines[i].a, clippedLines[i].b, increment);
-    beamPosition = {clippedLines[i].b.x, clippedLines[i].b.y};
+  uint32_t state[] = {increment,
+                      sampleBudget,
+                      (uint32_t)rasterizer.getLineAlgorithm(),
+                      pathOptimizer != nullptr,
+                      lines.getSize(),
+                      strips.getSize(),
+                      stripVertices.getSize(),
+                      curves.getSize(),
+                      pointBatches.getSize(),
+                      points.getSize()};
+  add(state, sizeof(state));
+  add(&beamPosition, sizeof(beamPosition));
+  add(&blankingPoint, sizeof(blankingPoint));
+  for (uint32_t i = 0; i < lines.getSize(); i++) {
+    add(&lines[i], sizeof(Line));
+  }
+  for (uint32_t i = 0; i < strips.getSize(); i++) {
+    add(&strips[i], sizeof(Strip));
+  }
+  for (uint32_t i = 0; i < stripVertices.getSize(); i++) {
+    add(&stripVertices[i], sizeof(Vector2));
+  }
+  // The clip flag of a curve follows from its range, and the padding after it isn't initialized
+  for (uint32_t i = 0; i < curves.getSize(); i++) {
+    add(&curves[i], offsetof(Curve, isClipped));
+  }
+  for (uint32_t i = 0; i < pointBatches.getSize(); i++) {
+    add(&pointBatches[i], sizeof(PointBatch));
+  }
+  for (uint32_t i = 0; i < points.getSize(); i++) {
+    add(&points[i], sizeof(Vector2));
   }
 
-  if (brightnessWriter != nullptr) {
-    brightnessWriter->write(brightnessTransform->transform(0));
+  return hash;
+}
+
+TIMER_CREATE(pathOptimize);
+TIMER_CREATE(rasterize);
+
+void Renderer::render() {
+  uint64_t frameHash = 0;
+  if (frameCache != nullptr) {
+    frameHash = getFrameHash();
+
+    TIMER_START(rasterize);
+    bool isCached = frameCache->replay(frameHash);
+    TIMER_STOP(rasterize);
+
+    if (isCached) {
+      beamPosition = frameCacheBeamPosition;
+
+      // Replaying takes a different time than rasterizing, so don't base the budget on this frame
+      lastFrameMicros = 0;
+
+      TIMER_SAVE(rasterize);
+      TIMER_PRINT(rasterize);
+      return;
+    }
+
+    frameCache->begin(frameHash);
+  }
+
+  // Reorder lines and points to minimize the blanking moves between them
+  TIMER_START(pathOptimize);
+  if (pathOptimizer != nullptr) {
+    pathOptimizer->optimize(lines, beamPosition, viewport);
+  }
+  orderPoints();
+  TIMER_STOP(pathOptimize);
+
+  TIMER_START(rasterize);
+  uint32_t rasterizeBegin = getMicros();
+  incrementScale = getIncrementScale();
+  frameStepCount = 0;
+  frameSampleCount = 0;
+
+  if (sampleStream != nullptr) {
+    sampleStream->begin();
+
+    // The stream replays the frame in a loop, so the beam returns from the end of the last line
+    // (followed by the strips, the curves and the points)
+    if (points.getSize() > 0) {
+      beamPosition = points.getLast();
+    } else if (curves.getSize() > 0) {
+      beamPosition = curves.getLast().getEnd();
+    } else if (stripVertices.getSize() > 0) {
+      beamPosition = stripVertices.getLast();
+    } else if (lines.getSize() > 0) {
+      beamPosition = lines.getLast().b;
+    }
   }
+
+  rasterizeLines();
+  uint32_t rasterizeMicros = getMicros() - rasterizeBegin;
   TIMER_STOP(rasterize);
 
-  TIMER_SAVE(viewportClip);
+  effectiveIncrement =
+      frameSampleCount > 0 ? frameStepCount / (float)frameSampleCount : increment;
+  if (refreshRate > 0) {
+    updateSampleBudget(frameSampleCount, rasterizeMicros);
+  }
+
+  TIMER_SAVE(pathOptimize);
   TIMER_SAVE(rasterize);
 
-  TIMER_PRINT(viewportClip);
+  TIMER_PRINT(pathOptimize);
   TIMER_PRINT(rasterize);
 
   // Turn off beam or move it outside the screen
@@ -93,4 +512,13 @@ void Renderer::render() {
   } else {
     rasterizer.drawPoint(blankingPoint);
   }
+
+  if (sampleStream != nullptr) {
+    sampleStream->end();
+  }
+
+  if (frameCache != nullptr) {
+    frameCache->end();
+    frameCacheBeamPosition = beamPosition;
+  }
 }
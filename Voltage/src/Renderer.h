@@ -8,8 +8,11 @@
 #include "Array.h"
 #include "Camera.h"
 #include "Clipper.h"
+#include "FrameCache.h"
 #include "Object.h"
+#include "PathOptimizer.h"
 #include "Rasterizer.h"
+#include "SampleStream.h"
 #include "Transform3D.h"
 #include "types.h"
 
@@ -21,6 +24,7 @@ class BrightnessTransform {
 
  public:
   BrightnessTransform(const DACWriter* writer) : maxValue(writer->getMaxValue()) {}
+  virtual ~BrightnessTransform() {}
   virtual uint32_t transform(float value) const = 0;
 };
 
@@ -36,54 +40,449 @@ class InvertedLinearBrightnessTransform : public BrightnessTransform {
   inline uint32_t transform(float value) const { return (uint32_t)((1.0 - value) * maxValue); }
 };
 
+class GammaBrightnessTransform final : public BrightnessTransform {
+  const float gamma;
+
+ public:
+  GammaBrightnessTransform(const DACWriter* writer, const float gamma)
+      : BrightnessTransform(writer), gamma(gamma) {}
+  inline uint32_t transform(float value) const {
+    return (uint32_t)(powf(fmaxf(value, 0), gamma) * maxValue);
+  }
+};
+
+// Bakes another transform (e.g. a gamma curve or a user-defined phosphor response) into a table of
+// evenly spaced levels, so that transforming a value costs a table lookup. Values are rounded to
+// the nearest level and clamped to [0, 1]. The table has at least two levels (zero and one).
+class LookupBrightnessTransform final : public BrightnessTransform {
+  static const uint32_t defaultLevelCount = 256;
+  const uint32_t levelCount;
+  uint32_t* table;
+
+ public:
+  LookupBrightnessTransform(const DACWriter* writer, const BrightnessTransform& curve,
+                            const uint32_t levelCount = defaultLevelCount)
+      : BrightnessTransform(writer), levelCount(levelCount > 2 ? levelCount : 2) {
+    table = new uint32_t[this->levelCount];
+    for (uint32_t i = 0; i < this->levelCount; i++) {
+      table[i] = curve.transform(i / (float)(this->levelCount - 1));
+    }
+  }
+
+  LookupBrightnessTransform(const LookupBrightnessTransform&) = delete;
+  LookupBrightnessTransform& operator=(const LookupBrightnessTransform&) = delete;
+
+  ~LookupBrightnessTransform() { delete[] table; }
+
+  inline uint32_t transform(float value) const {
+    if (value <= 0) {
+      return table[0];
+    }
+    if (value >= 1) {
+      return table[levelCount - 1];
+    }
+    return table[(uint32_t)(value * (levelCount - 1) + 0.5f)];
+  }
+};
+
 class Renderer {
+ protected:
   static const uint32_t defaultMaxLines = 1000;
+  static const uint32_t defaultMaxCurves = 100;
+  static const uint32_t defaultMaxStripVertices = 1000;
+  static const uint32_t defaultMaxPoints = 1000;
+
+ private:
   static const uint32_t blankingDrawIncrement = 16;
+  static const uint32_t maxLineIncrement = 64;
+  static const uint32_t maxCurveParts = 8;
+  static const uint32_t maxPointBatches = 16;
+  const float sampleBudgetSmoothing = 0.25;
   const float blankingBrightnessIncrement = 0.015;
   const uint32_t increment;
   Transform3D transform3D;
-  const Rasterizer rasterizer;
   const SingleDACWriter* brightnessWriter;
   const BrightnessTransform* brightnessTransform;
   Buffer<Line> lines;
-  Buffer<Line> clippedLines;
+  Buffer<Curve> curves;
+
+  // Line strips (parts of polylines and loops inside the viewport) share their vertices
+  struct Strip {
+    uint32_t firstVertex, vertexCount;
+    float brightness;
+  };
+  Buffer<Strip> strips;
+  Buffer<Vector2> stripVertices;
+
+  // Points with the same brightness and dwell added one after another form one batch, which is
+  // ordered along a Morton curve when rendered. The order keys hold the code in the upper and the
+  // index in the batch in the lower half word, so a batch has at most 65536 points.
+  struct PointBatch {
+    uint32_t firstPoint, pointCount;
+    float brightness;
+    uint32_t dwell;
+  };
+  static const uint32_t maxBatchPoints = 1 << 16;
+  Buffer<PointBatch> pointBatches;
+  Buffer<Vector2> points;
+  Array<uint32_t> pointOrder;
+  Array<uint32_t> pointOrderScratch;
   Vector2 beamPosition = {0, 0};
+  SampleStream* sampleStream = nullptr;
+  FrameCache* frameCache = nullptr;
+  Vector2 frameCacheBeamPosition = {0, 0};
+  PathOptimizer* pathOptimizer = nullptr;
+  uint32_t sampleBudget = 0;
+  float refreshRate = 0;
+  float effectiveIncrement;
+  uint32_t lastFrameMicros = 0;
+  float incrementScale = 0;
+  uint32_t frameStepCount = 0;
+  uint32_t frameSampleCount = 0;
+
+  // Brightness values of the ramp before a line, precomputed for brightnesses up to one. The ramp
+  // of a line is the prefix of the levels below its brightness.
+  float* blankingRampLevels = nullptr;
+  uint32_t* blankingRamp = nullptr;
+  uint32_t blankingRampSize = 0;
 
 #ifndef VOLTAGE_EMULATOR
   Teensy36Writer teensyLineWriter;
 #endif
 
   Viewport viewport = {-1.0, 1.0, 0.75, -0.75};
+  uint32_t viewportRevision = nextRevision();
   Vector2 blankingPoint = {1.0, 1.0};
 
+ protected:
+  Rasterizer rasterizer;
+
  public:
   Renderer(const uint32_t increment, DualDACWriter& lineWriter,
            SingleDACWriter* brightnessWriter = nullptr,
-           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines)
+           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines,
+           uint32_t maxCurves = defaultMaxCurves,
+           uint32_t maxStripVertices = defaultMaxStripVertices,
+           uint32_t maxPoints = defaultMaxPoints)
       : increment(increment),
-        transform3D(this, maxLines),
-        rasterizer(lineWriter),
+        transform3D(this),
         brightnessWriter(brightnessWriter),
         brightnessTransform(brightnessTransform),
         lines(maxLines),
-        clippedLines(maxLines) {}
+        curves(maxCurves),
+        strips(maxStripVertices / 2),
+        stripVertices(maxStripVertices),
+        pointBatches(maxPointBatches),
+        points(maxPoints),
+        pointOrder(maxPoints),
+        pointOrderScratch(maxPoints),
+        effectiveIncrement(increment),
+        rasterizer(lineWriter) {
+    createBlankingRamp();
+  }
+
+  // Rasterize into a double-buffered sample stream instead of writing to the DACs directly.
+  // The stream's consumer is responsible for replaying the finished frames to the DACs.
+  Renderer(const uint32_t increment, SampleStream& sampleStream,
+           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines,
+           uint32_t maxCurves = defaultMaxCurves,
+           uint32_t maxStripVertices = defaultMaxStripVertices,
+           uint32_t maxPoints = defaultMaxPoints)
+      : Renderer(increment, sampleStream.getLineWriter(), sampleStream.getBrightnessWriter(),
+                 brightnessTransform, maxLines, maxCurves, maxStripVertices,
+                 maxPoints) {
+    this->sampleStream = &sampleStream;
+  }
+
+  // Replay the samples of the previous frame from the cache when the lines of a frame haven't
+  // changed, instead of rasterizing them again
+  Renderer(const uint32_t increment, FrameCache& frameCache,
+           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines,
+           uint32_t maxCurves = defaultMaxCurves,
+           uint32_t maxStripVertices = defaultMaxStripVertices,
+           uint32_t maxPoints = defaultMaxPoints)
+      : Renderer(increment, frameCache.getLineWriter(), frameCache.getBrightnessWriter(),
+                 brightnessTransform, maxLines, maxCurves, maxStripVertices,
+                 maxPoints) {
+    this->frameCache = &frameCache;
+  }
 
 #ifndef VOLTAGE_EMULATOR
   Renderer(const uint32_t increment = 1, SingleDACWriter* brightnessWriter = nullptr,
-           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines)
-      : Renderer(increment, teensyLineWriter, brightnessWriter, brightnessTransform, maxLines) {}
+           BrightnessTransform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines,
+           uint32_t maxCurves = defaultMaxCurves,
+           uint32_t maxStripVertices = defaultMaxStripVertices,
+           uint32_t maxPoints = defaultMaxPoints)
+      : Renderer(increment, teensyLineWriter, brightnessWriter, brightnessTransform, maxLines,
+                 maxCurves, maxStripVertices, maxPoints) {}
 #endif
 
+  virtual ~Renderer() {
+    delete[] blankingRampLevels;
+    delete[] blankingRamp;
+  }
+
   void setViewport(const Viewport& viewport);
+  const Viewport& getViewport() const { return viewport; }
+  uint32_t getViewportRevision() const { return viewportRevision; }
   void setBlankingPoint(const Vector2& blankingPoint);
+  void setLineAlgorithm(LineAlgorithm lineAlgorithm);
+  void setPathOptimizer(PathOptimizer* pathOptimizer);
+
+  // Remove the parts of lines hidden behind the front faces of the objects added in the same call
+  // (nullptr disables the removal)
+  void setHiddenLineRemover(HiddenLineRemover* hiddenLineRemover);
+
+  // Simplify the lines of the objects added in the same call in screen space, dropping sub-step
+  // edges and merging nearly collinear connected ones (nullptr disables the simplification)
+  void setEdgeSimplifier(EdgeSimplifier* edgeSimplifier);
+
+  // Limit the number of samples per frame. When the lines wouldn't fit in the budget with the
+  // renderer's increment, each line gets an increment of its own, so that short and bright lines
+  // get proportionally more samples. Zero disables the limit.
+  void setSampleBudget(uint32_t sampleBudget);
+
+  // Adjust the sample budget after every frame to hold the given refresh rate (frames per second),
+  // based on the measured frame time and rasterization speed. Zero disables the adjustment.
+  void setRefreshRate(float refreshRate);
+
+  uint32_t getSampleBudget() const { return sampleBudget; }
+
+  // Average number of DAC steps per sample of the lines in the last frame
+  float getEffectiveIncrement() const { return effectiveIncrement; }
+
   void clear();
   void add(const Line& line);
+
+  // Connected lines through the vertices, drawn without blanking between them. The vertices are
+  // stored once, and a strip is split only where it leaves the viewport. Vertices that don't fit
+  // anymore are dropped.
+  void addPolyline(const Vector2* vertices, const uint32_t vertexCount, const float brightness);
+
+  // Polyline returning from the last vertex to the first one
+  void addLoop(const Vector2* vertices, const uint32_t vertexCount, const float brightness);
+
+  // Points drawn with dwell samples each (e.g. particles or stars). Points outside the viewport are
+  // dropped, as are points that don't fit anymore. The points are reordered to shorten the moves
+  // between them, and the beam jumps directly from one point to the next.
+  void addPoints(const Vector2* points, const uint32_t count, const float brightness,
+                 const uint32_t dwell = 1);
+
+  // Curves are clipped to the viewport and rasterized directly instead of being split into lines.
+  // Curves that don't fit anymore are dropped. A circle is an arc over a full turn.
+  void addArc(const Arc& arc);
+  void addEllipse(const Ellipse& ellipse);
+  void addBezier(const QuadraticBezier& bezier);
+  void addBezier(const CubicBezier& bezier);
+
   void add(Object* object, Camera& camera);
   void add(const Array<Object*>& objects, Camera& camera);
   void addViewport();
   void render();
+
+  // Number of lines (after clipping) added since the last clear
+  uint32_t getLineCount() const { return lines.getSize(); }
+
+  // Number of curves (after clipping, which may split them into parts) added since the last clear
+  uint32_t getCurveCount() const { return curves.getSize(); }
+
+  // Number of line strips (after clipping) and the lines in them added since the last clear
+  uint32_t getStripCount() const { return strips.getSize(); }
+  uint32_t getStripLineCount() const { return stripVertices.getSize() - strips.getSize(); }
+
+  // Number of points (after clipping) added since the last clear
+  uint32_t getPointCount() const { return points.getSize(); }
+
+ protected:
+  // Draw the lines, line strips, curves and points of the frame. Called once per frame, so that
+  // StaticRenderer can replace the virtual writers with its own.
+  virtual void rasterizeLines();
+
+  template <typename R, typename BW, typename BT>
+  void rasterizeLines(const R& frameRasterizer, const BW* frameBrightnessWriter,
+                      const BT* frameBrightnessTransform);
+
+ private:
+  friend class Transform3D;
+
+  // Add a line that is already clipped to the viewport, unless the buffer is full
+  void addClipped(const Line& line);
+
+  void addCurve(const Curve& curve);
+  void addStrip(const Vector2* vertices, const uint32_t vertexCount, const bool isClosed,
+                const float brightness);
+
+  // Sort the points of each batch by their Morton codes
+  void orderPoints();
+
+  // Samples written for the points, which aren't affected by the sample budget
+  uint32_t getPointSampleCount() const;
+
+  // Turn off the beam and move it to the start of the next line or curve, then ramp the brightness
+  // up to the brightness of it
+  template <typename R, typename BW, typename BT>
+  void moveBeam(const R& frameRasterizer, const BW* frameBrightnessWriter,
+                const BT* frameBrightnessTransform, const Vector2& target, float brightness);
+
+  void createBlankingRamp();
+
+  // Length of the precomputed ramp up to the given brightness, or -1 if it isn't covered
+  int32_t getBlankingRampLength(float brightness) const;
+
+  // Hash of everything the samples of the frame depend on
+  uint64_t getFrameHash() const;
+
+  float getIncrementScale();
+  uint32_t getLineIncrement(float brightness, uint32_t steps, float incrementScale) const;
+  void updateSampleBudget(uint32_t sampleCount, uint32_t rasterizeMicros);
+};
+
+// Renderer with the writer and brightness transform types resolved at compile time, so that the
+// per-sample calls in the rasterization loop can be inlined. The types should be final classes
+// (like Final<Teensy36Writer>), otherwise the calls are still dispatched virtually. For example:
+// StaticRenderer<Final<Teensy36Writer>, Final<MCP4922Writer>, Final<LinearBrightnessTransform>>.
+template <typename LineWriter, typename BrightnessWriter = SingleDACWriter,
+          typename Transform = BrightnessTransform>
+class StaticRenderer : public Renderer {
+  BasicRasterizer<LineWriter> staticRasterizer;
+  const BrightnessWriter* staticBrightnessWriter;
+  const Transform* staticBrightnessTransform;
+
+ public:
+  StaticRenderer(const uint32_t increment, LineWriter& lineWriter,
+                 BrightnessWriter* brightnessWriter = nullptr,
+                 Transform* brightnessTransform = nullptr, uint32_t maxLines = defaultMaxLines,
+                 uint32_t maxCurves = defaultMaxCurves,
+                 uint32_t maxStripVertices = defaultMaxStripVertices,
+                 uint32_t maxPoints = defaultMaxPoints)
+      : Renderer(increment, lineWriter, brightnessWriter, brightnessTransform, maxLines,
+                 maxCurves, maxStripVertices, maxPoints),
+        staticRasterizer(lineWriter),
+        staticBrightnessWriter(brightnessWriter),
+        staticBrightnessTransform(brightnessTransform) {}
+
+ protected:
+  void rasterizeLines() {
+    staticRasterizer.setLineAlgorithm(rasterizer.getLineAlgorithm());
+    Renderer::rasterizeLines(staticRasterizer, staticBrightnessWriter, staticBrightnessTransform);
+  }
 };
 
+template <typename R, typename BW, typename BT>
+void Renderer::moveBeam(const R& frameRasterizer, const BW* frameBrightnessWriter,
+                        const BT* frameBrightnessTransform, const Vector2& target,
+                        float brightness) {
+  if (frameBrightnessWriter == nullptr ||
+      (beamPosition.x == target.x && beamPosition.y == target.y)) {
+    return;
+  }
+
+  frameBrightnessWriter->write(frameBrightnessTransform->transform(0));
+  frameRasterizer.drawLine(beamPosition, target, blankingDrawIncrement);
+
+  // Interpolate brightness in order to avoid aliasing artifacts
+  int32_t rampLength = getBlankingRampLength(brightness);
+  if (rampLength >= 0) {
+    for (int32_t j = 0; j < rampLength; j++) {
+      frameRasterizer.drawPoint(target);
+      frameBrightnessWriter->write(blankingRamp[j]);
+    }
+  } else {
+    for (float z = 0; z < brightness; z += blankingBrightnessIncrement) {
+      frameRasterizer.drawPoint(target);
+      frameBrightnessWriter->write(frameBrightnessTransform->transform(z));
+    }
+  }
+  frameBrightnessWriter->write(frameBrightnessTransform->transform(brightness));
+}
+
+template <typename R, typename BW, typename BT>
+void Renderer::rasterizeLines(const R& frameRasterizer, const BW* frameBrightnessWriter,
+                              const BT* frameBrightnessTransform) {
+  bool isBudgeted = sampleBudget > 0 || refreshRate > 0;
+
+  for (uint32_t i = 0; i < lines.getSize(); i++) {
+    moveBeam(frameRasterizer, frameBrightnessWriter, frameBrightnessTransform, lines[i].a,
+             lines[i].brightness);
+
+    uint32_t lineIncrement = increment;
+    if (isBudgeted) {
+      uint32_t steps = frameRasterizer.getSteps(lines[i].a, lines[i].b);
+      lineIncrement = getLineIncrement(lines[i].brightness, steps, incrementScale);
+      frameStepCount += steps;
+      frameSampleCount += steps / lineIncrement + 1;
+    }
+
+    frameRasterizer.drawLine(lines[i].a, lines[i].b, lineIncrement);
+    beamPosition = {lines[i].b.x, lines[i].b.y};
+  }
+
+  // The segments of a strip are connected, so the beam is only moved to the start of the strip
+  for (uint32_t i = 0; i < strips.getSize(); i++) {
+    const Vector2* vertices = &stripVertices[strips[i].firstVertex];
+    uint32_t lastVertex = strips[i].vertexCount - 1;
+    moveBeam(frameRasterizer, frameBrightnessWriter, frameBrightnessTransform, vertices[0],
+             strips[i].brightness);
+
+    for (uint32_t j = 0; j < lastVertex; j++) {
+      uint32_t lineIncrement = increment;
+      if (isBudgeted) {
+        uint32_t steps = frameRasterizer.getSteps(vertices[j], vertices[j + 1]);
+        lineIncrement = getLineIncrement(strips[i].brightness, steps, incrementScale);
+        frameStepCount += steps;
+        frameSampleCount += steps / lineIncrement + 1;
+      }
+
+      frameRasterizer.drawLine(vertices[j], vertices[j + 1], lineIncrement);
+    }
+    beamPosition = vertices[lastVertex];
+  }
+
+  for (uint32_t i = 0; i < curves.getSize(); i++) {
+    moveBeam(frameRasterizer, frameBrightnessWriter, frameBrightnessTransform,
+             curves[i].getStart(), curves[i].brightness);
+
+    uint32_t curveIncrement = increment;
+    if (isBudgeted) {
+      uint32_t steps = frameRasterizer.getCurveSteps(curves[i]);
+      curveIncrement = getLineIncrement(curves[i].brightness, steps, incrementScale);
+      frameStepCount += steps;
+      frameSampleCount += std::max(steps / curveIncrement, 1u) + 1;
+    }
+
+    frameRasterizer.drawCurve(curves[i], curveIncrement);
+    beamPosition = curves[i].getEnd();
+  }
+
+  // Without a brightness writer the beam stays on, otherwise it's turned off for the jump to each
+  // point and on for the dwell samples
+  for (uint32_t i = 0; i < pointBatches.getSize(); i++) {
+    const PointBatch& batch = pointBatches[i];
+    const Vector2* batchPoints = &points[batch.firstPoint];
+    if (frameBrightnessWriter == nullptr) {
+      frameRasterizer.drawPoints(batchPoints, batch.pointCount, batch.dwell);
+    } else {
+      uint32_t off = frameBrightnessTransform->transform(0);
+      uint32_t on = frameBrightnessTransform->transform(batch.brightness);
+      for (uint32_t j = 0; j < batch.pointCount; j++) {
+        frameBrightnessWriter->write(off);
+        frameRasterizer.drawPoint(batchPoints[j]);
+        frameBrightnessWriter->write(on);
+        frameRasterizer.drawPoints(&batchPoints[j], 1, batch.dwell);
+      }
+    }
+    beamPosition = batchPoints[batch.pointCount - 1];
+  }
+
+  if (isBudgeted) {
+    frameSampleCount += getPointSampleCount();
+  }
+
+  if (frameBrightnessWriter != nullptr) {
+    frameBrightnessWriter->write(frameBrightnessTransform->transform(0));
+  }
+}
+
 }  // namespace voltage
 
 #endif
@@ -0,0 +1,103 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#else
+#include <thread>
+#endif
+
+#include "SampleStream.h"
+
+using namespace voltage;
+
+SampleStream::SampleStream(const uint32_t capacity, const DualDACWriter& lineWriter,
+                           const SingleDACWriter* brightnessWriter)
+    : lineWriter(lineWriter),
+      brightnessWriter(brightnessWriter),
+      capacity(capacity),
+      sizes{0, 0},
+      streamLineWriter(*this),
+      streamBrightnessWriter(*this),
+      back(0),
+      backSize(0),
+      droppedSampleCount(0),
+      front(noFrame),
+      position(0),
+      ready(noFrame) {
+  buffers[0] = new uint32_t[capacity];
+  buffers[1] = new uint32_t[capacity];
+}
+
+SampleStream::~SampleStream() {
+  delete[] buffers[0];
+  delete[] buffers[1];
+}
+
+void SampleStream::begin() {
+  // The previously finished frame has to be picked up by the consumer before the buffer it
+  // replaced (i.e. the current back buffer) can be written again
+  while (ready.load(std::memory_order_acquire) != noFrame) {
+#ifdef VOLTAGE_EMULATOR
+    // Let the consumer thread run (on device the consumer is an interrupt and preempts us anyway)
+    std::this_thread::yield();
+#endif
+  }
+
+  backSize = 0;
+  droppedSampleCount = 0;
+}
+
+void SampleStream::end() {
+  sizes[back] = backSize;
+  ready.store(back, std::memory_order_release);
+  back ^= 1;
+}
+
+uint32_t SampleStream::replay(const uint32_t maxSamples) {
+  uint32_t written = 0;
+
+  while (written < maxSamples) {
+    if (position == 0) {
+      int32_t finished = ready.load(std::memory_order_acquire);
+      if (finished != noFrame) {
+        front = finished;
+        ready.store(noFrame, std::memory_order_release);
+      }
+    }
+
+    if (front == noFrame || sizes[front] == 0) {
+      break;
+    }
+
+    uint32_t count = std::min(sizes[front] - position, maxSamples - written);
+    writeSamples(buffers[front] + position, count, lineWriter, brightnessWriter);
+
+    written += count;
+    position = position + count == sizes[front] ? 0 : position + count;
+  }
+
+  return written;
+}
+
+void SampleStream::writeSamples(const uint32_t* samples, const uint32_t count,
+                                const DualDACWriter& lineWriter,
+                                const SingleDACWriter* brightnessWriter) {
+  uint32_t i = 0;
+
+  while (i < count) {
+    uint32_t end = i + 1;
+
+    if (samples[i] & brightnessFlag) {
+      if (brightnessWriter != nullptr) {
+        brightnessWriter->write(samples[i] & ~brightnessFlag);
+      }
+    } else {
+      // Line samples are packed like DualDACWriter expects, so the run of them up to the next
+      // brightness sample can be written in one batch
+      while (end < count && !(samples[end] & brightnessFlag)) {
+        end++;
+      }
+      lineWriter.writeBatch(samples + i, end - i);
+    }
+
+    i = end;
+  }
+}
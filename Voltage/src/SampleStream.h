@@ -0,0 +1,112 @@
+#ifndef VOLTAGE_SAMPLE_STREAM_H_
+#define VOLTAGE_SAMPLE_STREAM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "Writer.h"
+
+namespace voltage {
+
+// Double-buffered stream of DAC samples.
+//
+// The renderer (producer) rasterizes a frame into the back buffer while a consumer (e.g. a timer
+// interrupt on Teensy or a thread in the emulator) keeps replaying the last finished frame from
+// the front buffer to the actual DACs. Finished frames are handed over without locks, so exactly
+// one producer and one consumer are supported.
+class SampleStream {
+ public:
+  // Samples are packed to 32 bits: line samples have x in the lower and y in the upper half word,
+  // brightness samples are marked with the most significant bit.
+  static const uint32_t brightnessFlag = 0x80000000;
+  static const int32_t noFrame = -1;
+
+  class LineWriter final : public DualDACWriter {
+    SampleStream& stream;
+
+   public:
+    LineWriter(SampleStream& stream) : stream(stream) {}
+    uint32_t getMaxValue() const { return stream.lineWriter.getMaxValue(); }
+    void write(uint32_t a, uint32_t b) const { stream.push(packSample(a, b)); }
+    void writeBatch(const uint32_t* samples, uint32_t count) const {
+      stream.pushBatch(samples, count);
+    }
+  };
+
+  class BrightnessWriter final : public SingleDACWriter {
+    SampleStream& stream;
+
+   public:
+    BrightnessWriter(SampleStream& stream) : stream(stream) {}
+    uint32_t getMaxValue() const { return stream.brightnessWriter->getMaxValue(); }
+    void write(uint32_t value) const { stream.push(value | brightnessFlag); }
+  };
+
+ private:
+  const DualDACWriter& lineWriter;
+  const SingleDACWriter* brightnessWriter;
+  const uint32_t capacity;
+  uint32_t* buffers[2];
+  uint32_t sizes[2];
+
+  // Producer state
+  LineWriter streamLineWriter;
+  BrightnessWriter streamBrightnessWriter;
+  uint32_t back;
+  uint32_t backSize;
+  uint32_t droppedSampleCount;
+
+  // Consumer state
+  int32_t front;
+  uint32_t position;
+
+  // Index of a finished frame not yet picked up by the consumer
+  std::atomic<int32_t> ready;
+
+ public:
+  SampleStream(const uint32_t capacity, const DualDACWriter& lineWriter,
+               const SingleDACWriter* brightnessWriter = nullptr);
+  ~SampleStream();
+
+  // Producer interface. The writers append samples to the back buffer between begin and end calls.
+  // Samples exceeding the capacity of the buffer are dropped.
+  DualDACWriter& getLineWriter() { return streamLineWriter; }
+  SingleDACWriter* getBrightnessWriter() {
+    return brightnessWriter != nullptr ? &streamBrightnessWriter : nullptr;
+  }
+  void begin();
+  void end();
+  uint32_t getDroppedSampleCount() const { return droppedSampleCount; }
+
+  // Consumer interface. Writes at most maxSamples samples of the current front frame to the DACs,
+  // starting over from the beginning of the frame when its end is reached. A newly finished frame
+  // is swapped in only at a frame boundary, so frames are never torn.
+  // Returns the number of samples written, which is zero until the first frame is finished.
+  uint32_t replay(const uint32_t maxSamples);
+
+  // Write packed samples to the DACs. Runs of line samples are written in batches.
+  static void writeSamples(const uint32_t* samples, const uint32_t count,
+                           const DualDACWriter& lineWriter,
+                           const SingleDACWriter* brightnessWriter);
+
+ private:
+  void push(const uint32_t sample) {
+    if (backSize < capacity) {
+      buffers[back][backSize++] = sample;
+    } else {
+      droppedSampleCount++;
+    }
+  }
+
+  void pushBatch(const uint32_t* samples, const uint32_t count) {
+    uint32_t pushed = count < capacity - backSize ? count : capacity - backSize;
+    std::copy(samples, samples + pushed, buffers[back] + backSize);
+    backSize += pushed;
+    droppedSampleCount += count - pushed;
+  }
+};
+
+}  // namespace voltage
+
+#endif
@@ -1,31 +1,216 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#else
+#include <chrono>
+#if defined(VOLTAGE_PROFILE_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define VOLTAGE_TIMER_RDTSC
+#endif
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 #include "Timer.h"
 
 using namespace voltage;
 
-void Timer::start() { begin = micros(); }
+Timer *Timer::first = nullptr;
+
+#if !defined(VOLTAGE_EMULATOR)
+// The DWT cycle counter is 32 bits wide, so durations are computed modulo 2^32 (which is correct as
+// long as a single duration is shorter than the wrap around time, ~24 s at 180 MHz)
+typedef uint32_t Ticks;
+
+static void enableTicks() {
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+}
+
+static inline Ticks getTicks() { return ARM_DWT_CYCCNT; }
+
+uint64_t Timer::getTicksPerSecond() { return F_CPU; }
+#elif defined(VOLTAGE_TIMER_RDTSC)
+typedef uint64_t Ticks;
+
+static void enableTicks() {}
+
+static inline Ticks getTicks() { return __rdtsc(); }
+
+// Calibrate the time stamp counter against the steady clock once
+uint64_t Timer::getTicksPerSecond() {
+  typedef std::chrono::steady_clock Clock;
+  static uint64_t ticksPerSecond = 0;
+
+  if (ticksPerSecond == 0) {
+    Clock::time_point beginTime = Clock::now();
+    Ticks beginTicks = getTicks();
+    double seconds = 0;
+    while (seconds < 0.05) {
+      seconds = std::chrono::duration<double>(Clock::now() - beginTime).count();
+    }
+    ticksPerSecond = (getTicks() - beginTicks) / seconds;
+  }
+
+  return ticksPerSecond;
+}
+#else
+typedef uint64_t Ticks;
+
+static void enableTicks() {}
+
+static inline Ticks getTicks() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t Timer::getTicksPerSecond() { return 1000000000; }
+#endif
+
+static void writeText(const char *text) {
+#ifdef VOLTAGE_EMULATOR
+  fputs(text, stdout);
+#else
+  Serial.print(text);
+#endif
+}
 
-void Timer::stop() { elapsed += micros() - begin; }
+static void writeData(const void *data, const size_t size) {
+#ifdef VOLTAGE_EMULATOR
+  fwrite(data, 1, size, stdout);
+#else
+  Serial.write((const uint8_t *)data, size);
+#endif
+}
+
+static void writeCsvHeader() { writeText("name,count,min_us,max_us,mean_us,p50_us,p99_us\n"); }
+
+static void writeCsvRow(const char *name, const TimerStatistics &s) {
+  char row[128];
+  snprintf(row, sizeof(row), "%s,%lu,%.3f,%.3f,%.3f,%.3f,%.3f\n", name, (unsigned long)s.count,
+           s.min, s.max, s.mean, s.p50, s.p99);
+  writeText(row);
+}
+
+Timer::Timer(const char *name, const uint32_t windowSize)
+    : name(name),
+      windowSize(windowSize),
+      sampleIndex(0),
+      sampleCount(0),
+      newSampleCount(0),
+      begin(0),
+      elapsed(0),
+      total(0),
+      next(first) {
+  samples = new uint32_t[windowSize];
+  sorted = new uint32_t[windowSize];
+  first = this;
+  enableTicks();
+}
+
+Timer::~Timer() {
+  delete[] samples;
+  delete[] sorted;
+}
+
+void Timer::start() { begin = getTicks(); }
+
+void Timer::stop() {
+  Ticks duration = getTicks() - (Ticks)begin;
+  elapsed += duration;
+  total += duration;
+}
 
 void Timer::save() {
-  if (sampleIndex < sampleCount) {
-    samples[sampleIndex++] = elapsed;
-    elapsed = 0;
+  if (windowSize > 0) {
+    samples[sampleIndex] = (uint32_t)std::min(elapsed, (uint64_t)UINT32_MAX);
+    sampleIndex = (sampleIndex + 1) % windowSize;
+    sampleCount = std::min(sampleCount + 1, windowSize);
+    newSampleCount++;
   }
+  elapsed = 0;
 }
 
 void Timer::print() {
-  if (!isPrinted && sampleIndex == sampleCount) {
-    uint64_t sum = 0;
-    for (uint32_t i = 0; i < sampleCount; i++) {
-      sum += samples[i];
+  static bool isHeaderPrinted = false;
+
+  if (windowSize == 0 || newSampleCount < windowSize) {
+    return;
+  }
+
+  if (!isHeaderPrinted) {
+    writeCsvHeader();
+    isHeaderPrinted = true;
+  }
+  writeCsvRow(name, getStatistics());
+  newSampleCount = 0;
+}
+
+TimerStatistics Timer::getStatistics() {
+  TimerStatistics statistics = {sampleCount, 0, 0, 0, 0, 0};
+  if (sampleCount == 0) {
+    return statistics;
+  }
+
+  // Percentiles use the nearest rank method
+  std::copy(samples, samples + sampleCount, sorted);
+  std::sort(sorted, sorted + sampleCount);
+  uint32_t p50Index = (sampleCount - 1) / 2;
+  uint32_t p99Index = (sampleCount * 99 + 99) / 100 - 1;
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    sum += sorted[i];
+  }
+
+  float microsecondsPerTick = 1e6 / getTicksPerSecond();
+  statistics.min = sorted[0] * microsecondsPerTick;
+  statistics.max = sorted[sampleCount - 1] * microsecondsPerTick;
+  statistics.mean = sum * microsecondsPerTick / sampleCount;
+  statistics.p50 = sorted[p50Index] * microsecondsPerTick;
+  statistics.p99 = sorted[p99Index] * microsecondsPerTick;
+
+  return statistics;
+}
+
+Timer *Timer::find(const char *name) {
+  for (Timer *timer = first; timer != nullptr; timer = timer->next) {
+    if (strcmp(timer->name, name) == 0) {
+      return timer;
     }
-    double avg = sum / (double)sampleCount;
+  }
+  return nullptr;
+}
 
-    Serial.print(name);
-    Serial.print(": ");
-    Serial.print(avg / 1000);
-    Serial.println(" ms");
+void Timer::resetAll() {
+  for (Timer *timer = first; timer != nullptr; timer = timer->next) {
+    timer->reset();
+  }
+}
+
+void Timer::dump(DumpFormat format) {
+  if (format == DumpFormat::Csv) {
+    writeCsvHeader();
+    for (Timer *timer = first; timer != nullptr; timer = timer->next) {
+      writeCsvRow(timer->name, timer->getStatistics());
+    }
+    return;
+  }
+
+  uint32_t timerCount = 0;
+  for (Timer *timer = first; timer != nullptr; timer = timer->next) {
+    timerCount++;
+  }
+  writeData("VTPR", 4);
+  writeData(&timerCount, sizeof(timerCount));
 
-    isPrinted = true;
+  for (Timer *timer = first; timer != nullptr; timer = timer->next) {
+    TimerRecord record;
+    memset(record.name, 0, sizeof(record.name));
+    strncpy(record.name, timer->name, sizeof(record.name) - 1);
+    record.statistics = timer->getStatistics();
+    writeData(&record, sizeof(record));
   }
 }
@@ -1,6 +1,13 @@
-// Uncomment for enabling performance profiling
+// Uncomment for enabling performance profiling. The timers keep statistics over a rolling window of
+// the given number of frames, and print them as CSV every time the window has been filled.
 // #define VOLTAGE_PROFILE_SAMPLES 100
 
+// Defining VOLTAGE_PROFILE alone enables the timers without printing, so that the timings can be
+// read with Timer::find or Timer::dump (e.g. in benchmarks)
+#if defined(VOLTAGE_PROFILE_SAMPLES) && !defined(VOLTAGE_PROFILE)
+#define VOLTAGE_PROFILE
+#endif
+
 #ifndef VOLTAGE_TIMER_H_
 #define VOLTAGE_TIMER_H_
 
@@ -8,14 +15,20 @@
 #include <Arduino.h>
 #endif
 
+#include <cstdint>
 #include <string>
 
+#ifdef VOLTAGE_PROFILE
 #ifdef VOLTAGE_PROFILE_SAMPLES
 #define TIMER_CREATE(name) static Timer _timer_##name(#name, VOLTAGE_PROFILE_SAMPLES)
+#define TIMER_PRINT(name) _timer_##name.print()
+#else
+#define TIMER_CREATE(name) static Timer _timer_##name(#name, 100)
+#define TIMER_PRINT(name)
+#endif
 #define TIMER_START(name) _timer_##name.start()
 #define TIMER_STOP(name) _timer_##name.stop()
 #define TIMER_SAVE(name) _timer_##name.save()
-#define TIMER_PRINT(name) _timer_##name.print()
 #else
 #define TIMER_CREATE(name)
 #define TIMER_START(name)
@@ -26,26 +39,67 @@
 
 namespace voltage {
 
+// Statistics over the frames in a timer's window, times in microseconds
+struct TimerStatistics {
+  uint32_t count;
+  float min, max, mean, p50, p99;
+};
+
+// Binary dumps start with the magic "VTPR" and a uint32 timer count, followed by one record per
+// timer. All values are little endian.
+struct TimerRecord {
+  char name[16];
+  TimerStatistics statistics;
+};
+
+enum class DumpFormat { Csv, Binary };
+
+// Profiling timer for a named scope. Time is measured with the DWT cycle counter on Teensy, and
+// with std::chrono (or rdtsc, if VOLTAGE_PROFILE_RDTSC is defined on x86) on host. The time
+// between start and stop calls is accumulated until save, which stores it as one frame in a ring
+// buffer of the last windowSize frames.
 class Timer {
   const char *name;
-  const size_t sampleCount;
-  uint64_t *samples;
+  const uint32_t windowSize;
+  uint32_t *samples;
+  uint32_t *sorted;
   uint32_t sampleIndex;
+  uint32_t sampleCount;
+  uint32_t newSampleCount;
   uint64_t begin;
   uint64_t elapsed;
-  bool isPrinted;
+  uint64_t total;
+
+  // All timers are kept in a linked list, so that they can be looked up by name and dumped
+  Timer *next;
+  static Timer *first;
 
  public:
-  Timer(const char *name, const size_t sampleCount)
-      : name(name), sampleCount(sampleCount), sampleIndex(0), elapsed(0), isPrinted(false) {
-    samples = new uint64_t[sampleCount];
-  }
-  ~Timer() { delete samples; }
+  Timer(const char *name, const uint32_t windowSize);
+  ~Timer();
 
   void start();
   void stop();
   void save();
+
+  // Print the statistics as a CSV row every time the window has been filled with new frames
   void print();
+
+  const char *getName() const { return name; }
+  TimerStatistics getStatistics();
+
+  // Time accumulated since the last reset in seconds
+  double getTotal() const { return total / (double)getTicksPerSecond(); }
+  void reset() { total = 0; }
+
+  static Timer *find(const char *name);
+  static void resetAll();
+
+  // Write the statistics of all timers to Serial (stdout on host). Can be called at any time,
+  // e.g. when a command is received over Serial.
+  static void dump(DumpFormat format = DumpFormat::Csv);
+
+  static uint64_t getTicksPerSecond();
 };
 
 }  // namespace voltage
@@ -11,134 +11,288 @@
 using namespace voltage;
 
 TIMER_CREATE(transform);
-TIMER_CREATE(nearClip);
+TIMER_CREATE(clip);
 TIMER_CREATE(faceCulling);
+TIMER_CREATE(hiddenLines);
+TIMER_CREATE(simplify);
 
 void Transform3D::transform(const Array<Object*>& objects, Camera& camera) {
-  Matrix viewMatrix = camera.getViewMatrix();
-  Matrix projectionMatrix = camera.getProjectionMatrix();
+  Frustum frustum(camera.getProjectionMatrix(), renderer->getViewport());
+  uint32_t firstLine = renderer->lines.getSize();
+
+  if (hiddenLineRemover != nullptr) {
+    hiddenLineRemover->clear();
+  }
 
   for (uint32_t i = 0; i < objects.getCapacity(); i++) {
-    transform(objects[i], viewMatrix, projectionMatrix);
+    transform(objects[i], camera, frustum);
+  }
+
+  // Lines of the objects are collected by the hidden line remover and added once all the faces
+  // that could hide them are known
+  if (hiddenLineRemover != nullptr) {
+    TIMER_START(hiddenLines);
+    hiddenLineRemover->removeHiddenLines(renderer->getViewport());
+    const Buffer<Line>& lines = hiddenLineRemover->getVisibleLines();
+    for (uint32_t i = 0; i < lines.getSize(); i++) {
+      renderer->addClipped(lines[i]);
+    }
+    TIMER_STOP(hiddenLines);
+  }
+
+  // Simplify the visible lines of the objects in screen space
+  if (edgeSimplifier != nullptr) {
+    TIMER_START(simplify);
+    edgeSimplifier->simplify(renderer->lines, firstLine, renderer->rasterizer.getScale());
+    TIMER_STOP(simplify);
   }
 
   TIMER_SAVE(transform);
-  TIMER_SAVE(nearClip);
+  TIMER_SAVE(clip);
   TIMER_SAVE(faceCulling);
+  TIMER_SAVE(hiddenLines);
+  TIMER_SAVE(simplify);
 
   TIMER_PRINT(transform);
-  TIMER_PRINT(nearClip);
+  TIMER_PRINT(clip);
   TIMER_PRINT(faceCulling);
+  TIMER_PRINT(hiddenLines);
+  TIMER_PRINT(simplify);
 }
 
-void Transform3D::transform(Object* object, const Matrix& viewMatrix,
-                            const Matrix& projectionMatrix) {
-  Mesh* mesh = object->mesh;
+void Transform3D::transform(Object* object, Camera& camera, const Frustum& frustum) {
+  const Mesh* mesh = object->mesh;
+
+  // If nothing has changed since the object was transformed, its cache still holds its lines
+  bool hasOccluders = hiddenLineRemover != nullptr;
+  TransformState state = {object->revision, camera.getRevision(),
+                          renderer->getViewportRevision(), mesh->revision, object->culling,
+                          object->shading, hasOccluders};
+  TransformCache* cache = object->transformCache;
+  if (cache != nullptr && cache->holds(state)) {
+    addCachedOccluders(object, *cache->occluders);
+    addEdges(object, cache->edges);
+    return;
+  }
 
-  // Transform camera to model space and perform face culling.
-  // If culling is disabled, mark all faces and vertices visible
   TIMER_START(faceCulling);
-  Matrix modelViewMatrix = MatrixMultiply(object->getModelMatrix(), viewMatrix);
-  Matrix viewModelMatrix = MatrixInvert(modelViewMatrix);
-  Vector3 cameraPosition = Vector3Transform({0, 0, 0}, viewModelMatrix);
+  if (object->modelViewObjectRevision != object->revision ||
+      object->modelViewCameraRevision != camera.getRevision()) {
+    object->modelViewMatrix = MatrixMultiply(object->getModelMatrix(), camera.getViewMatrix());
+    object->modelViewProjectionMatrix =
+        MatrixMultiply(object->modelViewMatrix, camera.getProjectionMatrix());
+    object->cameraPosition = Vector3Transform({0, 0, 0}, MatrixInvert(object->modelViewMatrix));
+    object->modelViewObjectRevision = object->revision;
+    object->modelViewCameraRevision = camera.getRevision();
+  }
+
+  // Test the bounding sphere against the view frustum. Objects completely outside are skipped, and
+  // edges of objects completely inside don't need to be clipped.
+  const Vector4& sphere = mesh->boundingSphere;
+  Vector3 center = Vector3Transform({sphere.x, sphere.y, sphere.z}, object->modelViewMatrix);
+  Vector3& s = object->scaling;
+  float radius = sphere.w * fmaxf(fabsf(s.x), fmaxf(fabsf(s.y), fabsf(s.z)));
+
+  Intersection intersection = frustum.testSphere(center, radius);
+  if (intersection == Intersection::Outside) {
+    TIMER_STOP(faceCulling);
+    return;
+  }
+
+  workspace.reserve(*mesh);
+  if (cache != nullptr) {
+    cache->reserve(*mesh);
+    cache->isValid = false;
+    cache->occluders->clear();
+  }
 
-  mesh->setVerticesVisible(false);
+  // Perform face culling with the camera transformed to model space.
+  // If culling is disabled, mark all faces visible
+  const Vector3& cameraPosition = object->cameraPosition;
+  VertexStore& store = *workspace.vertices;
+  bool* isFaceVisible = workspace.isFaceVisible;
+  store.setAllVisible(false);
 
   for (uint32_t i = 0; i < mesh->faceCount; i++) {
-    Face& face = mesh->faces[i];
+    const Face& face = mesh->faces[i];
     if (object->culling == Culling::Front || object->culling == Culling::Back) {
-      float angle = face.getNormalAngle(cameraPosition);
-      face.isVisible = object->culling == Culling::Front ? angle < 0 : angle > 0;
+      float angle = mesh->getNormalAngle(face, cameraPosition);
+      isFaceVisible[i] = object->culling == Culling::Front ? angle < 0 : angle > 0;
     } else if (object->shading == Shading::Hidden) {
-      face.isVisible = face.getNormalAngle(cameraPosition) > 0;
+      isFaceVisible[i] = mesh->getNormalAngle(face, cameraPosition) > 0;
     } else {
-      face.isVisible = true;
+      isFaceVisible[i] = true;
     }
 
-    for (uint32_t j = 0; j < face.edgeCount; j++) {
-      face.edges[j]->vertices.a->isVisible = true;
-      face.edges[j]->vertices.b->isVisible = true;
+    // Front faces hide lines of other objects, so their vertices are needed even if the face is
+    // culled
+    if (hasOccluders && mesh->getNormalAngle(face, cameraPosition) > 0) {
+      for (uint32_t j = 0; j < face.vertexCount; j++) {
+        store.setVisible(mesh->getFaceVertex(face, j));
+      }
+    }
+  }
+
+  // Define edge culling from adjacent face/faces. Edges of culled faces can still be drawn through
+  // an adjacent visible face. The culling information is also needed later when rendering hidden
+  // lines with different brightness.
+  TransformWorkspace::EdgeResult* results = cache != nullptr ? cache->edges : workspace.edges;
+  for (uint32_t i = 0; i < mesh->edgeCount; i++) {
+    const Edge& edge = mesh->edges[i];
+    bool isCulled = (edge.faces.a < 0 || !isFaceVisible[edge.faces.a]) &&
+                    (edge.faces.b < 0 || !isFaceVisible[edge.faces.b]);
+    results[i].isCulled = isCulled;
+    if (!isCulled || object->culling == Culling::None) {
+      store.setVisible(edge.vertices.a);
+      store.setVisible(edge.vertices.b);
     }
   }
   TIMER_STOP(faceCulling);
 
-  // Transform visible vertices (i.e. the ones being part of a potentially visible edge)
+  // Transform and perspective divide visible vertices (i.e. the ones being part of a potentially
+  // visible edge)
   TIMER_START(transform);
-  Matrix modelViewProjectionMatrix = MatrixMultiply(modelViewMatrix, projectionMatrix);
-  mesh->transformVisibleVertices(modelViewProjectionMatrix);
+  store.transform(mesh->vertices, mesh->vertexCount, object->modelViewProjectionMatrix);
   TIMER_STOP(transform);
 
-  // Clip lines against camera near and far planes
-  // TODO: Do all clipping in clip space?
-  clippedVertices.clear();
-
-  TIMER_START(nearClip);
+  // Clip lines against the view volume in clip space. Unclipped endpoints use the vertices divided
+  // in the transform, clipped ones are divided here.
+  const Viewport& viewport = renderer->getViewport();
+  TIMER_START(clip);
   for (uint32_t i = 0; i < mesh->edgeCount; i++) {
-    Edge& edge = mesh->edges[i];
-    Vertex* ap = edge.vertices.a;
-    Vertex* bp = edge.vertices.b;
+    const Edge& edge = mesh->edges[i];
+    TransformWorkspace::EdgeResult& result = results[i];
+    uint32_t aIndex = edge.vertices.a;
+    uint32_t bIndex = edge.vertices.b;
 
-    edge.isVisible = false;
+    result.isVisible = false;
 
-    // Define edge culling from adjacent face/faces
-    // The culling infromation is needed later when rendering hidden lines with different brightness
-    edge.isCulled =
-        !edge.faces.a->isVisible && (edge.faces.b == nullptr || !edge.faces.b->isVisible);
+    if (object->culling != Culling::None && result.isCulled) {
+      continue;
+    }
 
-    if (object->culling != Culling::None && edge.isCulled) {
+    if (intersection == Intersection::Inside) {
+      result.clipped.a = store.getScreenPosition(aIndex);
+      result.clipped.b = store.getScreenPosition(bIndex);
+      if (hasOccluders) {
+        result.clippedInverseDepths = {1.0f / store.w[aIndex], 1.0f / store.w[bIndex]};
+      }
+      result.isVisible = true;
       continue;
     }
 
-    Vector4 a = ap->transformed;
-    Vector4 b = bp->transformed;
+    Vector4 a = store.getClipPosition(aIndex);
+    Vector4 b = store.getClipPosition(bIndex);
 
-    ClipResult clipResult = clipLineNearAndFar(a, b);
+    ClipResult clipResult = clipLine(a, b, viewport);
 
     if (clipResult == ClipResult::Outside) {
       continue;
     }
-    if (clipResult == ClipResult::AClipped || clipResult == ClipResult::BothClipped) {
-      clippedVertices.push({{0}, a, true});
-      ap = &clippedVertices.getLast();
-    }
-    if (clipResult == ClipResult::BClipped || clipResult == ClipResult::BothClipped) {
-      clippedVertices.push({{0}, b, true});
-      bp = &clippedVertices.getLast();
+    result.clipped.a = clipResult == ClipResult::AClipped || clipResult == ClipResult::BothClipped
+                           ? Vector4PerspectiveDivide(a)
+                           : store.getScreenPosition(aIndex);
+    result.clipped.b = clipResult == ClipResult::BClipped || clipResult == ClipResult::BothClipped
+                           ? Vector4PerspectiveDivide(b)
+                           : store.getScreenPosition(bIndex);
+    if (hasOccluders) {
+      result.clippedInverseDepths = {1.0f / a.w, 1.0f / b.w};
     }
+    result.isVisible = true;
+  }
+  TIMER_STOP(clip);
 
-    ap->isVisible = true;
-    bp->isVisible = true;
-    edge.clipped = {ap, bp};
-    edge.isVisible = true;
+  if (cache != nullptr) {
+    cache->state = state;
+    cache->isValid = true;
   }
-  TIMER_STOP(nearClip);
 
-  // Perspective divide visible both original and clipper-generated vertices
-  TIMER_START(transform);
-  for (uint32_t i = 0; i < mesh->vertexCount; i++) {
-    Vertex& vertex = mesh->vertices[i];
-    if (vertex.isVisible) {
-      vertex.perspectiveDivide();
+  addOccluders(object, cache);
+  addEdges(object, results);
+}
+
+// Front faces of the object are split into triangles for the hidden line remover, and kept in the
+// cache if there is one. Faces with vertices behind the camera are left out.
+void Transform3D::addOccluders(Object* object, TransformCache* cache) {
+  if (hiddenLineRemover == nullptr) {
+    return;
+  }
+
+  const Mesh* mesh = object->mesh;
+  const VertexStore& store = *workspace.vertices;
+
+  for (uint32_t i = 0; i < mesh->faceCount; i++) {
+    const Face& face = mesh->faces[i];
+    if (mesh->getNormalAngle(face, object->cameraPosition) <= 0) {
+      continue;
+    }
+
+    bool isInFront = true;
+    for (uint32_t j = 0; j < face.vertexCount; j++) {
+      isInFront = isInFront && store.w[mesh->getFaceVertex(face, j)] > 0;
+    }
+    if (!isInFront) {
+      continue;
+    }
+
+    Vector2 vertices[3];
+    float inverseDepths[3];
+    uint32_t first = mesh->getFaceVertex(face, 0);
+    vertices[0] = store.getScreenPosition(first);
+    inverseDepths[0] = 1.0f / store.w[first];
+
+    for (uint32_t j = 1; j + 1 < face.vertexCount; j++) {
+      for (uint32_t k = 0; k < 2; k++) {
+        uint32_t index = mesh->getFaceVertex(face, j + k);
+        vertices[k + 1] = store.getScreenPosition(index);
+        inverseDepths[k + 1] = 1.0f / store.w[index];
+      }
+      hiddenLineRemover->addTriangle(vertices, inverseDepths, object, (int32_t)i);
+      if (cache != nullptr) {
+        cache->occluders->push({{vertices[0], vertices[1], vertices[2]},
+                                {inverseDepths[0], inverseDepths[1], inverseDepths[2]},
+                                (int32_t)i});
+      }
     }
   }
-  for (uint32_t i = 0; i < clippedVertices.getSize(); i++) {
-    clippedVertices[i].perspectiveDivide();
+}
+
+void Transform3D::addCachedOccluders(Object* object,
+                                     const Buffer<TransformCache::Occluder>& occluders) {
+  if (hiddenLineRemover == nullptr) {
+    return;
   }
-  TIMER_STOP(transform);
 
-  // Add processed lines to render buffer
+  for (uint32_t i = 0; i < occluders.getSize(); i++) {
+    TransformCache::Occluder& occluder = occluders[i];
+    hiddenLineRemover->addTriangle(occluder.vertices, occluder.inverseDepths, object,
+                                   occluder.face);
+  }
+}
+
+void Transform3D::addEdges(Object* object, const TransformWorkspace::EdgeResult* results) {
+  const Mesh* mesh = object->mesh;
+
+  // Add processed lines to render buffer, bypassing the renderer's 2D viewport clipping. Mesh edges
+  // are ordered into strips, so consecutive lines share their endpoints (and don't need blanking)
+  // unless an edge in between is culled or clipped
   for (uint32_t i = 0; i < mesh->edgeCount; i++) {
-    Edge& edge = mesh->edges[i];
-    Vector4& a = edge.clipped.a->transformed;
-    Vector4& b = edge.clipped.b->transformed;
-
-    if (edge.isVisible) {
-      if (object->shading == Shading::Hidden) {
-        float brightness = edge.isCulled ? object->hiddenBrightness : object->brightness;
-        renderer->add({{a.x, a.y}, {b.x, b.y}, brightness});
-      } else {
-        renderer->add({{a.x, a.y}, {b.x, b.y}, object->brightness});
-      }
+    const TransformWorkspace::EdgeResult& result = results[i];
+
+    if (!result.isVisible) {
+      continue;
+    }
+
+    float brightness = object->shading == Shading::Hidden && result.isCulled
+                           ? object->hiddenBrightness
+                           : object->brightness;
+    Line line = {result.clipped.a, result.clipped.b, brightness};
+
+    if (hiddenLineRemover == nullptr ||
+        !hiddenLineRemover->addSegment(line, result.clippedInverseDepths.a,
+                                       result.clippedInverseDepths.b, object,
+                                       mesh->edges[i].faces.a, mesh->edges[i].faces.b)) {
+      renderer->addClipped(line);
     }
   }
 }
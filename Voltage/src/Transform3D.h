@@ -3,7 +3,12 @@
 
 #include "Array.h"
 #include "Camera.h"
+#include "Clipper.h"
+#include "EdgeSimplifier.h"
+#include "HiddenLineRemover.h"
 #include "Object.h"
+#include "TransformCache.h"
+#include "TransformWorkspace.h"
 #include "types.h"
 
 namespace voltage {
@@ -12,16 +17,26 @@ class Renderer;
 
 class Transform3D {
   Renderer* renderer;
-  Buffer<Vertex> clippedVertices;
+  HiddenLineRemover* hiddenLineRemover = nullptr;
+  EdgeSimplifier* edgeSimplifier = nullptr;
+  TransformWorkspace workspace;
 
  public:
-  Transform3D(Renderer* renderer, uint32_t maxLines)
-      : renderer(renderer), clippedVertices(maxLines) {}
+  Transform3D(Renderer* renderer) : renderer(renderer) {}
+
+  void setHiddenLineRemover(HiddenLineRemover* hiddenLineRemover) {
+    this->hiddenLineRemover = hiddenLineRemover;
+  }
+
+  void setEdgeSimplifier(EdgeSimplifier* edgeSimplifier) { this->edgeSimplifier = edgeSimplifier; }
 
   void transform(const Array<Object*>& objects, Camera& camera);
 
  private:
-  void transform(Object* object, const Matrix& viewMatrix, const Matrix& projectionMatrix);
+  void transform(Object* object, Camera& camera, const Frustum& frustum);
+  void addEdges(Object* object, const TransformWorkspace::EdgeResult* results);
+  void addOccluders(Object* object, TransformCache* cache);
+  void addCachedOccluders(Object* object, const Buffer<TransformCache::Occluder>& occluders);
 };
 
 }  // namespace voltage
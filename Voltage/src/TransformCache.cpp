@@ -0,0 +1,37 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include "TransformCache.h"
+
+using namespace voltage;
+
+TransformCache::TransformCache()
+    : edges(nullptr), occluders(nullptr), state(), isValid(false), edgeCapacity(0) {}
+
+TransformCache::~TransformCache() {
+  delete[] edges;
+  delete occluders;
+}
+
+void TransformCache::reserve(const Mesh& mesh) {
+  if (edgeCapacity < mesh.edgeCount) {
+    delete[] edges;
+    edges = new TransformWorkspace::EdgeResult[mesh.edgeCount];
+    edgeCapacity = mesh.edgeCount;
+    isValid = false;
+  }
+
+  // Faces are split into fans of triangles
+  uint32_t triangleCount = 0;
+  for (uint32_t i = 0; i < mesh.faceCount; i++) {
+    if (mesh.faces[i].vertexCount > 2) {
+      triangleCount += mesh.faces[i].vertexCount - 2;
+    }
+  }
+  if (occluders == nullptr || occluders->getCapacity() < triangleCount) {
+    delete occluders;
+    occluders = new Buffer<Occluder>(triangleCount);
+    isValid = false;
+  }
+}
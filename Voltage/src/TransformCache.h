@@ -0,0 +1,49 @@
+#ifndef VOLTAGE_TRANSFORM_CACHE_H_
+#define VOLTAGE_TRANSFORM_CACHE_H_
+
+#include <cstdint>
+
+#include "Array.h"
+#include "Mesh.h"
+#include "Object.h"
+#include "TransformWorkspace.h"
+#include "types.h"
+
+namespace voltage {
+
+// Clipped edges and occluding triangles of one object, kept between frames (see
+// Object::setTransformCache). While the object, camera, viewport and mesh don't change, Transform3D
+// adds the cached results instead of culling, transforming and clipping the object again. The
+// cache grows to fit the mesh of its object.
+class TransformCache {
+ public:
+  struct Occluder {
+    Vector2 vertices[3];
+    float inverseDepths[3];
+    int32_t face;
+  };
+
+  TransformWorkspace::EdgeResult* edges;
+  Buffer<Occluder>* occluders;
+
+  // State the results were computed for, if valid
+  TransformState state;
+  bool isValid;
+
+  TransformCache();
+  TransformCache(const TransformCache&) = delete;
+  TransformCache& operator=(const TransformCache&) = delete;
+  ~TransformCache();
+
+  // Make room for the mesh. Growing drops the current results.
+  void reserve(const Mesh& mesh);
+
+  bool holds(const TransformState& state) const { return isValid && this->state == state; }
+
+ private:
+  uint32_t edgeCapacity;
+};
+
+}  // namespace voltage
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#include "TransformWorkspace.h"
+
+using namespace voltage;
+
+TransformWorkspace::TransformWorkspace()
+    : vertices(nullptr),
+      isFaceVisible(nullptr),
+      edges(nullptr),
+      faceCapacity(0),
+      edgeCapacity(0) {}
+
+TransformWorkspace::~TransformWorkspace() {
+  delete vertices;
+  delete[] isFaceVisible;
+  delete[] edges;
+}
+
+void TransformWorkspace::reserve(const Mesh& mesh) {
+  if (vertices == nullptr || vertices->capacity < mesh.vertexCount) {
+    delete vertices;
+    vertices = new VertexStore(mesh.vertexCount);
+  }
+  if (faceCapacity < mesh.faceCount) {
+    delete[] isFaceVisible;
+    isFaceVisible = new bool[mesh.faceCount];
+    faceCapacity = mesh.faceCount;
+  }
+  if (edgeCapacity < mesh.edgeCount) {
+    delete[] edges;
+    edges = new EdgeResult[mesh.edgeCount];
+    edgeCapacity = mesh.edgeCount;
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef VOLTAGE_TRANSFORM_WORKSPACE_H_
+#define VOLTAGE_TRANSFORM_WORKSPACE_H_
+
+#include <cstdint>
+
+#include "Mesh.h"
+#include "VertexStore.h"
+#include "types.h"
+
+namespace voltage {
+
+// Scratch memory for transforming a mesh for an object: the transformed vertices, the visibility
+// of the faces and the clipped edges. Transform3D reuses a single workspace for all the objects,
+// and grows it when a mesh larger than any previous one is transformed. Objects with a
+// TransformCache get their edges clipped into the cache instead.
+class TransformWorkspace {
+ public:
+  struct EdgeResult {
+    Pair<Vector2> clipped;
+    Pair<float> clippedInverseDepths;
+    bool isVisible;
+    bool isCulled;
+  };
+
+  VertexStore* vertices;
+  bool* isFaceVisible;
+  EdgeResult* edges;
+
+  TransformWorkspace();
+  TransformWorkspace(const TransformWorkspace&) = delete;
+  TransformWorkspace& operator=(const TransformWorkspace&) = delete;
+  ~TransformWorkspace();
+
+  // Make room for the mesh
+  void reserve(const Mesh& mesh);
+
+ private:
+  uint32_t faceCapacity;
+  uint32_t edgeCapacity;
+};
+
+}  // namespace voltage
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "VertexStore.h"
+
+using namespace voltage;
+
+VertexStore::VertexStore(const uint32_t capacity) : capacity(capacity) {
+  x = new float[capacity];
+  y = new float[capacity];
+  z = new float[capacity];
+  w = new float[capacity];
+  screenX = new float[capacity];
+  screenY = new float[capacity];
+  visibility = new uint32_t[(capacity + 31) / 32];
+  setAllVisible(false);
+}
+
+VertexStore::~VertexStore() {
+  delete[] x;
+  delete[] y;
+  delete[] z;
+  delete[] w;
+  delete[] screenX;
+  delete[] screenY;
+  delete[] visibility;
+}
+
+void VertexStore::setAllVisible(const bool isVisible) {
+  uint32_t word = isVisible ? UINT32_MAX : 0;
+  for (uint32_t i = 0; i < (capacity + 31) / 32; i++) {
+    visibility[i] = word;
+  }
+}
+
+static inline void transformVertex(const Vector3& p, const Matrix& m, const uint32_t i,
+                                   VertexStore& store) {
+  float x = m.m0 * p.x + m.m4 * p.y + m.m8 * p.z + m.m12;
+  float y = m.m1 * p.x + m.m5 * p.y + m.m9 * p.z + m.m13;
+  float z = m.m2 * p.x + m.m6 * p.y + m.m10 * p.z + m.m14;
+  float w = m.m3 * p.x + m.m7 * p.y + m.m11 * p.z + m.m15;
+  float div = 1.0f / w;
+
+  store.x[i] = x;
+  store.y[i] = y;
+  store.z[i] = z;
+  store.w[i] = w;
+  store.screenX[i] = x * div;
+  store.screenY[i] = y * div;
+}
+
+#if defined(__AVX__)
+
+// Transform eight vertices at a time with AVX
+static inline void transformBlock(const Vector3* v, const Matrix& m, const uint32_t i,
+                                  VertexStore& store) {
+  __m256 px = _mm256_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x,
+                             v[4].x, v[5].x, v[6].x, v[7].x);
+  __m256 py = _mm256_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y,
+                             v[4].y, v[5].y, v[6].y, v[7].y);
+  __m256 pz = _mm256_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z,
+                             v[4].z, v[5].z, v[6].z, v[7].z);
+
+#define VOLTAGE_ROW(a, b, c, d)                                             \
+  _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(a)), \
+                                            _mm256_mul_ps(py, _mm256_set1_ps(b))), \
+                              _mm256_mul_ps(pz, _mm256_set1_ps(c))),              \
+                _mm256_set1_ps(d))
+  __m256 x = VOLTAGE_ROW(m.m0, m.m4, m.m8, m.m12);
+  __m256 y = VOLTAGE_ROW(m.m1, m.m5, m.m9, m.m13);
+  __m256 z = VOLTAGE_ROW(m.m2, m.m6, m.m10, m.m14);
+  __m256 w = VOLTAGE_ROW(m.m3, m.m7, m.m11, m.m15);
+#undef VOLTAGE_ROW
+  __m256 div = _mm256_div_ps(_mm256_set1_ps(1.0f), w);
+
+  _mm256_storeu_ps(store.x + i, x);
+  _mm256_storeu_ps(store.y + i, y);
+  _mm256_storeu_ps(store.z + i, z);
+  _mm256_storeu_ps(store.w + i, w);
+  _mm256_storeu_ps(store.screenX + i, _mm256_mul_ps(x, div));
+  _mm256_storeu_ps(store.screenY + i, _mm256_mul_ps(y, div));
+}
+
+#elif defined(__SSE__)
+
+// Transform four vertices at a time with SSE
+static inline void transformQuad(const Vector3* v, const Matrix& m, const uint32_t i,
+                                 VertexStore& store) {
+  __m128 px = _mm_setr_ps(v[0].x, v[1].x, v[2].x, v[3].x);
+  __m128 py = _mm_setr_ps(v[0].y, v[1].y, v[2].y, v[3].y);
+  __m128 pz = _mm_setr_ps(v[0].z, v[1].z, v[2].z, v[3].z);
+
+#define VOLTAGE_ROW(a, b, c, d)                                    \
+  _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(a)), \
+                                   _mm_mul_ps(py, _mm_set1_ps(b))), \
+                        _mm_mul_ps(pz, _mm_set1_ps(c))),           \
+             _mm_set1_ps(d))
+  __m128 x = VOLTAGE_ROW(m.m0, m.m4, m.m8, m.m12);
+  __m128 y = VOLTAGE_ROW(m.m1, m.m5, m.m9, m.m13);
+  __m128 z = VOLTAGE_ROW(m.m2, m.m6, m.m10, m.m14);
+  __m128 w = VOLTAGE_ROW(m.m3, m.m7, m.m11, m.m15);
+#undef VOLTAGE_ROW
+  __m128 div = _mm_div_ps(_mm_set1_ps(1.0f), w);
+
+  _mm_storeu_ps(store.x + i, x);
+  _mm_storeu_ps(store.y + i, y);
+  _mm_storeu_ps(store.z + i, z);
+  _mm_storeu_ps(store.w + i, w);
+  _mm_storeu_ps(store.screenX + i, _mm_mul_ps(x, div));
+  _mm_storeu_ps(store.screenY + i, _mm_mul_ps(y, div));
+}
+
+static inline void transformBlock(const Vector3* v, const Matrix& m, const uint32_t i,
+                                  VertexStore& store) {
+  transformQuad(v, m, i, store);
+  transformQuad(v + 4, m, i + 4, store);
+}
+
+#else
+
+// Scalar version unrolled by four (e.g. for Cortex-M4F), which lets the compiler interleave the
+// independent floating point operations and hide their latency
+static inline void transformBlock(const Vector3* v, const Matrix& m, const uint32_t i,
+                                  VertexStore& store) {
+  for (uint32_t j = 0; j < VertexStore::blockSize; j += 4) {
+    transformVertex(v[j], m, i + j, store);
+    transformVertex(v[j + 1], m, i + j + 1, store);
+    transformVertex(v[j + 2], m, i + j + 2, store);
+    transformVertex(v[j + 3], m, i + j + 3, store);
+  }
+}
+
+#endif
+
+void VertexStore::transform(const Vector3* vertices, const uint32_t count, const Matrix& matrix) {
+  uint32_t i = 0;
+
+  // 32-bit visibility words cover four blocks of eight vertices
+  for (; i + blockSize <= count; i += blockSize) {
+    if ((visibility[i >> 5] >> (i & 31)) & 0xFF) {
+      transformBlock(vertices + i, matrix, i, *this);
+    }
+  }
+
+  for (; i < count; i++) {
+    if (isVisible(i)) {
+      transformVertex(vertices[i], matrix, i, *this);
+    }
+  }
+}
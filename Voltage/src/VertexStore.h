@@ -0,0 +1,48 @@
+#ifndef VOLTAGE_VERTEX_STORE_H_
+#define VOLTAGE_VERTEX_STORE_H_
+
+#include <cstdint>
+
+#include "raymath.h"
+
+namespace voltage {
+
+// Structure-of-arrays storage for transformed vertices. Clip space coordinates are kept for
+// clipping, and perspective divided x and y for the vertices that end up on screen unclipped.
+// Visibility is stored as a bitmask, one bit per vertex.
+class VertexStore {
+ public:
+  // Vertices are transformed in blocks of this size
+  static const uint32_t blockSize = 8;
+
+  const uint32_t capacity;
+  float *x, *y, *z, *w;
+  float *screenX, *screenY;
+  uint32_t* visibility;
+
+  VertexStore(const uint32_t capacity);
+  VertexStore(const VertexStore&) = delete;
+  VertexStore& operator=(const VertexStore&) = delete;
+  ~VertexStore();
+
+  void setAllVisible(const bool isVisible);
+  void setVisible(const uint32_t index) { visibility[index >> 5] |= 1u << (index & 31); }
+  bool isVisible(const uint32_t index) const {
+    return (visibility[index >> 5] >> (index & 31)) & 1;
+  }
+
+  Vector4 getClipPosition(const uint32_t index) const {
+    return {x[index], y[index], z[index], w[index]};
+  }
+  Vector2 getScreenPosition(const uint32_t index) const {
+    return {screenX[index], screenY[index]};
+  }
+
+  // Transform the visible vertices with the matrix and divide them by w.
+  // Blocks without any visible vertices are skipped, other blocks are transformed as a whole.
+  void transform(const Vector3* vertices, const uint32_t count, const Matrix& matrix);
+};
+
+}  // namespace voltage
+
+#endif
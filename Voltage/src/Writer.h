@@ -5,6 +5,9 @@
 
 namespace voltage {
 
+// Samples for dual DACs are packed to 32 bits, a in the lower and b in the upper half word
+inline uint32_t packSample(const uint32_t a, const uint32_t b) { return a | (b << 16); }
+
 class DACWriter {
  public:
   virtual uint32_t getMaxValue() const = 0;
@@ -18,6 +21,23 @@ class SingleDACWriter : public DACWriter {
 class DualDACWriter : public DACWriter {
  public:
   virtual void write(uint32_t a, uint32_t b) const = 0;
+
+  // Writers that can consume samples in bulk (e.g. over DMA or into a texture) can override this.
+  // The samples are packed with packSample.
+  virtual void writeBatch(const uint32_t* samples, uint32_t count) const {
+    for (uint32_t i = 0; i < count; i++) {
+      write(samples[i] & 0xFFFF, samples[i] >> 16);
+    }
+  }
+};
+
+// Final variant of a writer or brightness transform class (e.g. Final<Teensy36Writer>) for
+// StaticRenderer and BasicRasterizer. Calls to the virtual methods of a final class are resolved at
+// compile time, while the class itself can still be subclassed.
+template <typename Base>
+class Final final : public Base {
+ public:
+  using Base::Base;
 };
 
 }  // namespace voltage
@@ -15,6 +15,33 @@ struct Line {
   float brightness;
 };
 
+// Circular arc drawn from the start to the end angle (in radians from the x axis), i.e.
+// counterclockwise when the end angle is larger, over at most a full turn
+struct Arc {
+  Vector2 center;
+  float radius;
+  float startAngle, endAngle;
+  float brightness;
+};
+
+// Ellipse rotated counterclockwise by the rotation (in radians)
+struct Ellipse {
+  Vector2 center;
+  Vector2 radii;
+  float rotation;
+  float brightness;
+};
+
+struct QuadraticBezier {
+  Vector2 a, control, b;
+  float brightness;
+};
+
+struct CubicBezier {
+  Vector2 a, controlA, controlB, b;
+  float brightness;
+};
+
 }  // namespace voltage
 
 #endif
@@ -1,6 +1,14 @@
 #ifndef VOLTAGE_UTILS_H_
 #define VOLTAGE_UTILS_H_
 
+#ifndef VOLTAGE_EMULATOR
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+#include <cstdint>
+
 #include "raymath.h"
 
 // Supplementary functions for raymath
@@ -19,10 +27,40 @@ inline Vector4 Vector4Lerp(const Vector4 &a, const Vector4 &b, const float amoun
           a.w + amount * (b.w - a.w)};
 }
 
+inline Vector2 Vector4PerspectiveDivide(const Vector4 &v) {
+  float div = 1.0 / v.w;
+  return {v.x * div, v.y * div};
+}
+
+// Hash of an undirected edge, i.e. independent of the order of the vertex indices
+inline uint32_t hashEdge(const uint32_t a, const uint32_t b) {
+  uint32_t low = a < b ? a : b;
+  uint32_t high = a < b ? b : a;
+  return (low * 73856093u) ^ (high * 19349663u);
+}
+
 inline Vector3 Vector3Midpoint(const Vector3 &a, const Vector3 &b) {
   return {(a.x + b.x) / 2.0f, (a.y + b.y) / 2.0f, (a.z + b.z) / 2.0f};
 }
 
+// Unique, increasing revision numbers for telling whether cached state is up to date. Zero is never
+// returned, so it can be used for "not cached".
+inline uint32_t nextRevision() {
+  static uint32_t revision = 0;
+  return ++revision;
+}
+
+// Monotonic time in microseconds, wrapping around after ~71 minutes
+inline uint32_t getMicros() {
+#ifdef VOLTAGE_EMULATOR
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#else
+  return micros();
+#endif
+}
+
 }  // namespace voltage
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef VOLTAGE_BENCHMARK_CHECKSUM_WRITER_H_
+#define VOLTAGE_BENCHMARK_CHECKSUM_WRITER_H_
+
+#include "../Voltage/src/Writer.h"
+
+// Writer that counts the samples and hashes them (FNV-1a) in order, so that changes in the
+// rendered output can be detected
+class ChecksumWriter final : public voltage::DualDACWriter {
+  static const uint64_t offsetBasis = 14695981039346656037ull;
+  static const uint64_t prime = 1099511628211ull;
+
+  const uint32_t maxValue;
+  mutable uint64_t count;
+  mutable uint64_t checksum;
+
+ public:
+  ChecksumWriter(const uint32_t maxValue = 4095)
+      : maxValue(maxValue), count(0), checksum(offsetBasis) {}
+
+  uint32_t getMaxValue() const { return maxValue; }
+
+  void write(const uint32_t x, const uint32_t y) const {
+    checksum = (checksum ^ voltage::packSample(x, y)) * prime;
+    count++;
+  }
+
+  void writeBatch(const uint32_t* samples, const uint32_t count) const {
+    for (uint32_t i = 0; i < count; i++) {
+      checksum = (checksum ^ samples[i]) * prime;
+    }
+    this->count += count;
+  }
+
+  uint64_t getCount() const { return count; }
+  uint64_t getChecksum() const { return checksum; }
+  void reset() {
+    count = 0;
+    checksum = offsetBasis;
+  }
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef VOLTAGE_BENCHMARK_COUNTING_WRITER_H_
+#define VOLTAGE_BENCHMARK_COUNTING_WRITER_H_
+
+#include "../Voltage/src/Writer.h"
+
+// Writer that discards the samples and only counts them
+class CountingWriter final : public voltage::DualDACWriter {
+  const uint32_t maxValue;
+  mutable uint64_t count;
+
+ public:
+  CountingWriter(const uint32_t maxValue = 4095) : maxValue(maxValue), count(0) {}
+
+  uint32_t getMaxValue() const { return maxValue; }
+
+  void write(const uint32_t x, const uint32_t y) const { count++; }
+  void writeBatch(const uint32_t* samples, const uint32_t count) const { this->count += count; }
+
+  uint64_t getCount() const { return count; }
+  void reset() { count = 0; }
+};
+
+// Single channel variant, e.g. for brightness
+class CountingSingleWriter final : public voltage::SingleDACWriter {
+  const uint32_t maxValue;
+  mutable uint64_t count;
+
+ public:
+  CountingSingleWriter(const uint32_t maxValue = 4095) : maxValue(maxValue), count(0) {}
+
+  uint32_t getMaxValue() const { return maxValue; }
+
+  void write(const uint32_t value) const { count++; }
+
+  uint64_t getCount() const { return count; }
+  void reset() { count = 0; }
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef VOLTAGE_BENCHMARK_H_
+#define VOLTAGE_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdio>
+
+#define VOLTAGE_EMULATOR
+#include "../Voltage/src/Voltage.h"
+#include "../Voltage/src/Timer.h"
+#include "CountingWriter.h"
+
+// Run the callback repeatedly until at least minSeconds has elapsed.
+// Returns the number of seconds per callback invocation.
+template <typename F>
+double measure(F callback, const double minSeconds = 0.5) {
+  typedef std::chrono::steady_clock Clock;
+
+  uint64_t iterations = 0;
+  Clock::time_point begin = Clock::now();
+  double elapsed = 0;
+  do {
+    callback();
+    iterations++;
+    elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+  } while (elapsed < minSeconds);
+
+  return elapsed / iterations;
+}
+
+// Deterministic pseudo-random numbers, so that every run measures identical input
+class Random {
+  uint32_t state;
+
+ public:
+  Random(const uint32_t seed = 1) : state(seed) {}
+
+  uint32_t next() {
+    state = state * 1664525 + 1013904223;
+    return state;
+  }
+
+  // Uniform float in [min, max)
+  float next(const float min, const float max) {
+    return min + (next() >> 8) * (1.0f / 16777216.0f) * (max - min);
+  }
+};
+
+#endif
@@ -0,0 +1,118 @@
+// Curve benchmark
+//
+// Renders a HUD of range rings, a sweep arc, an ellipse and Bezier curves, once as native curves
+// and once with every curve split into short lines (like before curves were supported). Reports
+// the time to add (clip) and rasterize a frame, the buffer entries used and the samples written.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 2;
+const uint32_t maxLines = 20000;
+const uint32_t ringCount = 24;
+
+struct Result {
+  uint32_t entryCount;
+  uint32_t sampleCount;
+  double addMs;
+  double renderMs;
+};
+
+// Curves of the HUD, partly outside the viewport
+class Hud {
+ public:
+  Arc rings[ringCount];
+  Arc sweep;
+  Ellipse ellipse;
+  CubicBezier beziers[8];
+
+  Hud() {
+    for (uint32_t i = 0; i < ringCount; i++) {
+      rings[i] = {{0, 0}, 0.05f * (i + 1), 0, 2 * PI, 0.5};
+    }
+    sweep = {{0, 0}, 0.9f, 0.3f, 1.2f, 1.0};
+    ellipse = {{0.2f, -0.1f}, {0.7f, 0.25f}, 0.4f, 0.8};
+    for (uint32_t i = 0; i < 8; i++) {
+      float y = -0.7f + i * 0.2f;
+      beziers[i] = {{-1.2f, y}, {-0.4f, y + 0.5f}, {0.4f, y - 0.5f}, {1.2f, y}, 0.7};
+    }
+  }
+
+  void addCurves(Renderer& renderer) const {
+    for (uint32_t i = 0; i < ringCount; i++) {
+      renderer.addArc(rings[i]);
+    }
+    renderer.addArc(sweep);
+    renderer.addEllipse(ellipse);
+    for (uint32_t i = 0; i < 8; i++) {
+      renderer.addBezier(beziers[i]);
+    }
+  }
+
+  void addLines(Renderer& renderer, const uint32_t segments) const {
+    for (uint32_t i = 0; i < ringCount; i++) {
+      addLines(renderer, Curve::fromArc(rings[i]), segments);
+    }
+    addLines(renderer, Curve::fromArc(sweep), segments);
+    addLines(renderer, Curve::fromEllipse(ellipse), segments);
+    for (uint32_t i = 0; i < 8; i++) {
+      addLines(renderer, Curve::fromBezier(beziers[i]), segments);
+    }
+  }
+
+ private:
+  static void addLines(Renderer& renderer, const Curve& curve, const uint32_t segments) {
+    float dt = (curve.range.b - curve.range.a) / segments;
+    Vector2 previous = curve.getStart();
+    for (uint32_t i = 1; i <= segments; i++) {
+      Vector2 point = curve.getPoint(curve.range.a + dt * i);
+      renderer.add({previous, point, curve.brightness});
+      previous = point;
+    }
+  }
+};
+
+template <typename F>
+Result run(F addFrame) {
+  CountingWriter writer;
+  Renderer renderer(increment, writer, nullptr, nullptr, maxLines);
+
+  double addSeconds = measure([&]() {
+    renderer.clear();
+    addFrame(renderer);
+  });
+  uint32_t entryCount = renderer.getLineCount() + renderer.getCurveCount();
+
+  writer.reset();
+  uint32_t frames = 0;
+  double renderSeconds = measure([&]() {
+    renderer.render();
+    frames++;
+  });
+
+  return {entryCount, (uint32_t)(writer.getCount() / frames), addSeconds * 1e3,
+          renderSeconds * 1e3};
+}
+
+void print(const char* name, const Result& result) {
+  printf("%-12s %8u %9u %9.3f %9.3f %9.3f\n", name, result.entryCount, result.sampleCount,
+         result.addMs, result.renderMs, result.addMs + result.renderMs);
+}
+
+int main(int argc, char** argv) {
+  Hud hud;
+  printf("%-12s %8s %9s %9s %9s %9s\n", "primitives", "entries", "samples", "add ms", "render ms",
+         "total ms");
+
+  print("curves", run([&](Renderer& renderer) { hud.addCurves(renderer); }));
+
+  const uint32_t segmentCounts[] = {16, 32, 64};
+  for (uint32_t segments : segmentCounts) {
+    char name[32];
+    snprintf(name, sizeof(name), "lines x%u", segments);
+    print(name, run([&](Renderer& renderer) { hud.addLines(renderer, segments); }));
+  }
+
+  return 0;
+}
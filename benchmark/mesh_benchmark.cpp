@@ -0,0 +1,81 @@
+// Mesh construction benchmark
+//
+// Measures the time it takes to construct meshes of different sizes, i.e. the startup cost of
+// generating edges, strips and normals.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+// Grid of size x size quads on the xz plane
+struct Grid {
+  uint32_t vertexCount, faceCount;
+  Vector3* vertices;
+  FaceDefinition* faces;
+
+  Grid(const uint32_t size) {
+    vertexCount = (size + 1) * (size + 1);
+    faceCount = size * size;
+    vertices = new Vector3[vertexCount];
+    faces = new FaceDefinition[faceCount];
+
+    for (uint32_t z = 0; z <= size; z++) {
+      for (uint32_t x = 0; x <= size; x++) {
+        vertices[z * (size + 1) + x] = {(float)x / size - 0.5f, 0, (float)z / size - 0.5f};
+      }
+    }
+    for (uint32_t z = 0; z < size; z++) {
+      for (uint32_t x = 0; x < size; x++) {
+        uint32_t i = z * (size + 1) + x;
+        faces[z * size + x] = {i, i + size + 1, i + size + 2, i + 1};
+      }
+    }
+  }
+
+  ~Grid() {
+    for (uint32_t i = 0; i < faceCount; i++) {
+      delete[] faces[i].vertexIndices;
+    }
+    delete[] faces;
+    delete[] vertices;
+  }
+};
+
+void report(const char* name, const Mesh* mesh, const double seconds) {
+  printf("%-14s %8u %8u %8u %8u %12.3f\n", name, mesh->vertexCount, mesh->faceCount,
+         mesh->edgeCount, mesh->stripCount, seconds * 1e3);
+}
+
+int main(int argc, char** argv) {
+  printf("%-14s %8s %8s %8s %8s %12s\n", "mesh", "vertices", "faces", "edges", "strips",
+         "ms/mesh");
+
+  for (uint32_t size = 8; size <= 128; size *= 2) {
+    Grid grid(size);
+    Mesh* mesh = nullptr;
+    double seconds = measure([&]() {
+      delete mesh;
+      mesh = new Mesh(grid.vertices, grid.vertexCount, grid.faces, grid.faceCount);
+    });
+
+    char name[32];
+    snprintf(name, sizeof(name), "grid-%u", size);
+    report(name, mesh, seconds);
+    delete mesh;
+  }
+
+  for (uint32_t subdivisions = 1; subdivisions <= 5; subdivisions++) {
+    Mesh* mesh = nullptr;
+    double seconds = measure([&]() {
+      delete mesh;
+      mesh = MeshBuilder::createIcosphere(1.0, subdivisions);
+    });
+
+    char name[32];
+    snprintf(name, sizeof(name), "icosphere-%u", subdivisions);
+    report(name, mesh, seconds);
+    delete mesh;
+  }
+
+  return 0;
+}
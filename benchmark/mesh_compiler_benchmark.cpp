@@ -0,0 +1,111 @@
+// Mesh compiler benchmark
+//
+// Measures the conversion throughput of the mesh compiler (utils/mesh-compiler) for large OBJ
+// files, split into parsing, welding, building the mesh and writing the header. The boot time of
+// the output is compared between the definitions copied to RAM and the MeshData kept in flash.
+
+#include "benchmark.h"
+
+#include <string>
+
+#include "../utils/mesh-compiler/MeshCompiler.h"
+
+using namespace voltage;
+
+// OBJ text of a wavy grid of size x size quads, where every quad has vertices of its own (like in
+// files exported without merging vertices), so that welding removes three quarters of them
+std::string createGridObj(const uint32_t size) {
+  std::string text = "# Generated grid\n";
+  char line[96];
+  for (uint32_t z = 0; z < size; z++) {
+    for (uint32_t x = 0; x < size; x++) {
+      const uint32_t corners[4][2] = {{x, z}, {x, z + 1}, {x + 1, z + 1}, {x + 1, z}};
+      for (uint32_t i = 0; i < 4; i++) {
+        float u = (float)corners[i][0] / size - 0.5f;
+        float v = (float)corners[i][1] / size - 0.5f;
+        float y = sinf(u * 12.0f) * cosf(v * 9.0f) * 0.1f;
+        snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u, y, v);
+        text += line;
+      }
+      uint32_t i = (z * size + x) * 4 + 1;
+      snprintf(line, sizeof(line), "f %u/1/1 %u/1/1 %u/1/1 %u/1/1\n", i, i + 1, i + 2, i + 3);
+      text += line;
+    }
+  }
+  return text;
+}
+
+int main(int argc, char** argv) {
+  printf("%-10s %8s %8s %7s %9s %9s %9s %9s %8s %10s %10s\n", "mesh", "vertices", "faces", "MB",
+         "parse ms", "weld ms", "build ms", "write ms", "MB/s", "boot defs", "boot data");
+
+  for (uint32_t size = 64; size <= 512; size *= 2) {
+    std::string text = createGridObj(size);
+    MeshCompiler::Model model;
+    std::string error;
+    std::string header;
+    Mesh* mesh = nullptr;
+
+    double parseSeconds = measure([&]() { MeshCompiler::parseObj(text.c_str(), model, error); });
+    MeshCompiler::Model parsed = model;
+    double weldSeconds = measure([&]() {
+      model = parsed;
+      MeshCompiler::weldVertices(model);
+    });
+    double copySeconds = measure([&]() { model = parsed; });
+    MeshCompiler::weldVertices(model);
+    double buildSeconds = measure([&]() {
+      delete mesh;
+      mesh = MeshCompiler::buildMesh(model);
+    });
+    double writeSeconds = measure([&]() {
+      header = MeshCompiler::writeHeader(*mesh, "mesh", MeshCompiler::Format::Data);
+    });
+
+    // Boot time of the definitions output, i.e. copying the arrays and generating the strips and
+    // normals, against referring to the precomputed data
+    FaceDefinition* faces = new FaceDefinition[mesh->faceCount];
+    for (uint32_t i = 0; i < mesh->faceCount; i++) {
+      faces[i] = FaceDefinition(mesh->faces[i].vertexCount);
+      for (uint32_t j = 0; j < mesh->faces[i].vertexCount; j++) {
+        faces[i].vertexIndices[j] = mesh->getFaceVertex(mesh->faces[i], j);
+      }
+    }
+    EdgeDefinition* edges = new EdgeDefinition[mesh->edgeCount];
+    for (uint32_t i = 0; i < mesh->edgeCount; i++) {
+      edges[i] = {mesh->edges[i].vertices, mesh->edges[i].faces};
+    }
+
+    Mesh* booted = nullptr;
+    double definitionsSeconds = measure([&]() {
+      delete booted;
+      booted = new Mesh(mesh->vertices, mesh->vertexCount, faces, mesh->faceCount, edges,
+                        mesh->edgeCount);
+    });
+    MeshData data = mesh->getData();
+    double dataSeconds = measure([&]() {
+      delete booted;
+      booted = new Mesh(data);
+    });
+
+    weldSeconds -= copySeconds;
+    double totalSeconds = parseSeconds + weldSeconds + buildSeconds + writeSeconds;
+    double megabytes = text.size() / 1e6;
+    char name[32];
+    snprintf(name, sizeof(name), "grid-%u", size);
+    printf("%-10s %8u %8u %7.1f %9.2f %9.2f %9.2f %9.2f %8.1f %10.3f %10.5f\n", name,
+           (uint32_t)parsed.vertices.size(), mesh->faceCount, megabytes, parseSeconds * 1e3,
+           weldSeconds * 1e3, buildSeconds * 1e3, writeSeconds * 1e3, megabytes / totalSeconds,
+           definitionsSeconds * 1e3, dataSeconds * 1e3);
+
+    delete booted;
+    for (uint32_t i = 0; i < mesh->faceCount; i++) {
+      delete[] faces[i].vertexIndices;
+    }
+    delete[] faces;
+    delete[] edges;
+    delete mesh;
+  }
+
+  return 0;
+}
@@ -0,0 +1,121 @@
+// Hidden line removal benchmark
+//
+// Renders scenes of overlapping objects with and without the hidden line remover, and compares
+// the time spent removing hidden lines with the rasterization time saved by drawing fewer samples.
+// On the host the samples are only counted, so the time per removed sample tells the break-even
+// point: removal pays off when writing a sample to the DACs takes longer than that.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 2;
+const uint32_t maxLines = 20000;
+const uint32_t maxTriangles = 20000;
+
+struct Result {
+  uint32_t lineCount;
+  uint32_t sampleCount;
+  double hiddenLinesMs;
+  double rasterizeMs;
+  double totalMs;
+};
+
+// Objects sharing one mesh, with a camera orbiting slowly around the given target
+class Scene {
+ public:
+  const char* name;
+  Mesh* mesh;
+  Array<Object*> objects;
+  Vector3 eye;
+
+  Scene(const char* name, Mesh* mesh, const uint32_t objectCount, const Vector3& eye)
+      : name(name), mesh(mesh), objects(objectCount), eye(eye) {
+    for (uint32_t i = 0; i < objectCount; i++) {
+      objects[i] = new Object(mesh);
+    }
+  }
+
+  ~Scene() {
+    for (uint32_t i = 0; i < objects.getCapacity(); i++) {
+      delete objects[i];
+    }
+    delete mesh;
+  }
+
+  void add(Renderer& renderer, const uint32_t frame) {
+    float phase = frame * 0.01;
+    LookAtCamera camera;
+    camera.setEye(eye.x + sinf(phase), eye.y, eye.z);
+    renderer.add(objects, camera);
+  }
+};
+
+Result run(Scene& scene, HiddenLineRemover* hiddenLineRemover) {
+  CountingWriter writer;
+  Renderer renderer(increment, writer, nullptr, nullptr, maxLines);
+  renderer.setHiddenLineRemover(hiddenLineRemover);
+
+  scene.add(renderer, 0);
+  renderer.render();
+  uint32_t lineCount = renderer.getLineCount();
+
+  Timer::resetAll();
+  writer.reset();
+
+  uint32_t frame = 0;
+  double seconds = measure([&]() {
+    renderer.clear();
+    scene.add(renderer, frame++);
+    renderer.render();
+  });
+
+  auto msPerFrame = [&](const char* name) {
+    Timer* timer = Timer::find(name);
+    return timer != nullptr ? timer->getTotal() / frame * 1e3 : 0.0;
+  };
+
+  return {lineCount, (uint32_t)(writer.getCount() / frame), msPerFrame("hiddenLines"),
+          msPerFrame("rasterize"), seconds * 1e3};
+}
+
+void compare(Scene& scene) {
+  HiddenLineRemover hiddenLineRemover(maxTriangles, maxLines);
+  Result off = run(scene, nullptr);
+  Result on = run(scene, &hiddenLineRemover);
+
+  uint32_t removedSamples = off.sampleCount - on.sampleCount;
+  printf("%-14s %7u %7u %9u %9u %9.3f %9.3f %9.3f %9.3f %9.1f\n", scene.name, off.lineCount,
+         on.lineCount, off.sampleCount, on.sampleCount, on.hiddenLinesMs,
+         off.rasterizeMs - on.rasterizeMs, off.totalMs, on.totalMs,
+         removedSamples > 0 ? on.hiddenLinesMs * 1e6 / removedSamples : 0.0);
+}
+
+int main(int argc, char** argv) {
+  printf("%-14s %7s %7s %9s %9s %9s %9s %9s %9s %9s\n", "scene", "lines", "visible", "samples",
+         "visible", "hlr ms", "saved ms", "off ms", "on ms", "ns/sample");
+
+  // Rows of boxes seen from a low angle, each row hiding most of the one behind it
+  Scene buildings("buildings", MeshBuilder::createCube(1.0), 6 * 6, {0, 3.0, 16.0});
+  for (uint32_t z = 0; z < 6; z++) {
+    for (uint32_t x = 0; x < 6; x++) {
+      Object* object = buildings.objects[z * 6 + x];
+      object->setTranslation(x * 1.6f - 4.0f, 0, z * -1.6f);
+      object->setScaling(1.0, 1.0 + (x * 7 + z * 3) % 4 * 0.5f, 1.0);
+    }
+  }
+  compare(buildings);
+
+  // Icospheres behind each other along the view direction
+  Scene spheres("spheres", MeshBuilder::createIcosphere(1.0, 3), 4, {0, 0.5, 6.0});
+  for (uint32_t i = 0; i < 4; i++) {
+    spheres.objects[i]->setTranslation(i * 0.7f - 1.0f, 0, i * -2.5f);
+  }
+  compare(spheres);
+
+  // A single sphere without culling, whose back half is hidden by its front half
+  Scene sphere("sphere", MeshBuilder::createIcosphere(1.0, 3), 1, {0, 0, 3.0});
+  compare(sphere);
+
+  return 0;
+}
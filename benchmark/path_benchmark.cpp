@@ -0,0 +1,61 @@
+// PathOptimizer benchmark
+//
+// Renders meshes with and without the path optimizer and reports the blank travel, the number of
+// blanking jumps and the time spent per frame.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+struct Scene {
+  const char* name;
+  Mesh* mesh;
+};
+
+void run(const Scene& scene, const uint32_t twoOptBudget) {
+  CountingWriter writer;
+  // Brightness writer is needed for the renderer to perform blanking moves
+  CountingSingleWriter brightnessWriter;
+  LinearBrightnessTransform brightnessTransform(&brightnessWriter);
+  Renderer renderer(1, writer, &brightnessWriter, &brightnessTransform, 5000);
+
+  Object object(scene.mesh);
+  object.setRotation(0.3, 0.5, 0);
+  FreeCamera camera;
+  camera.setTranslation(0, 0, 3.0);
+
+  PathOptimizer optimizer(5000);
+  optimizer.setTwoOptBudget(twoOptBudget);
+
+  auto render = [&]() {
+    renderer.clear();
+    renderer.add(&object, camera);
+    renderer.render();
+  };
+
+  double baseline = measure(render);
+  renderer.setPathOptimizer(&optimizer);
+  double optimized = measure(render);
+  const PathStatistics& statistics = optimizer.getStatistics();
+
+  printf("%-12s %8u %10.2f %10.2f %8u %8u %10.3f %10.3f\n", scene.name, twoOptBudget,
+         statistics.blankTravelBefore, statistics.blankTravelAfter, statistics.blankJumpsBefore,
+         statistics.blankJumpsAfter, baseline * 1e3, optimized * 1e3);
+}
+
+int main(int argc, char** argv) {
+  Scene scenes[] = {{"cube", MeshBuilder::createCube(1.0)},
+                    {"icosphere-2", MeshBuilder::createIcosphere(1.0, 2)},
+                    {"icosphere-3", MeshBuilder::createIcosphere(1.0, 3)}};
+  uint32_t budgets[] = {0, 1000};
+
+  printf("%-12s %8s %10s %10s %8s %8s %10s %10s\n", "scene", "2-opt us", "travel", "after",
+         "jumps", "after", "ms/frame", "after");
+  for (const Scene& scene : scenes) {
+    for (uint32_t budget : budgets) {
+      run(scene, budget);
+    }
+  }
+
+  return 0;
+}
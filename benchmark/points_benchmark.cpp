@@ -0,0 +1,80 @@
+// Point benchmark
+//
+// Renders a starfield of random points, once with addPoints and once as zero-length lines (the
+// workaround before points were supported), with a brightness writer, so that every line gets a
+// blanking move. Reports the time to add and render a frame and the samples written per point,
+// which bounds the number of points that can be shown per frame at a given sample rate.
+
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 2;
+const uint32_t dwell = 2;
+
+struct Result {
+  uint32_t pointCount;
+  uint32_t sampleCount;
+  double addMs;
+  double renderMs;
+};
+
+template <typename F>
+Result run(const uint32_t maxCount, F addFrame) {
+  CountingWriter writer;
+  CountingSingleWriter brightnessWriter;
+  LinearBrightnessTransform brightnessTransform(&brightnessWriter);
+  Renderer renderer(increment, writer, &brightnessWriter, &brightnessTransform, maxCount, 0, 0,
+                    maxCount);
+
+  double addSeconds = measure([&]() {
+    renderer.clear();
+    addFrame(renderer);
+  });
+  uint32_t pointCount = renderer.getLineCount() + renderer.getPointCount();
+
+  writer.reset();
+  uint32_t frames = 0;
+  double renderSeconds = measure([&]() {
+    renderer.render();
+    frames++;
+  });
+
+  return {pointCount, (uint32_t)((writer.getCount() + brightnessWriter.getCount()) / frames),
+          addSeconds * 1e3, renderSeconds * 1e3};
+}
+
+int main(int argc, char** argv) {
+  printf("%-8s %-7s %8s %9s %9s %9s %9s %13s\n", "count", "method", "points", "samples",
+         "add ms", "render ms", "total ms", "samples/point");
+
+  Random random;
+  for (uint32_t count = 1000; count <= 16000; count *= 4) {
+    std::vector<Vector2> points(count);
+    for (uint32_t i = 0; i < count; i++) {
+      points[i] = {random.next(-1.0, 1.0), random.next(-0.75, 0.75)};
+    }
+
+    Result batched = run(count, [&](Renderer& renderer) {
+      renderer.addPoints(points.data(), count, 0.8, dwell);
+    });
+    Result lines = run(count, [&](Renderer& renderer) {
+      for (uint32_t i = 0; i < count; i++) {
+        renderer.add({points[i], points[i], 0.8});
+      }
+    });
+
+    const char* names[] = {"points", "lines"};
+    const Result* results[] = {&batched, &lines};
+    for (uint32_t i = 0; i < 2; i++) {
+      printf("%-8u %-7s %8u %9u %9.3f %9.3f %9.3f %13.1f\n", count, names[i],
+             results[i]->pointCount, results[i]->sampleCount, results[i]->addMs,
+             results[i]->renderMs, results[i]->addMs + results[i]->renderMs,
+             results[i]->sampleCount / (float)results[i]->pointCount);
+    }
+  }
+
+  return 0;
+}
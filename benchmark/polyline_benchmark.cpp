@@ -0,0 +1,85 @@
+// Polyline benchmark
+//
+// Renders waveforms (partly outside the viewport) once as polylines and once as separate lines,
+// and reports the time to add (clip) and rasterize a frame and the bytes of lines and vertices
+// stored. The output samples are identical, so the difference is the per-line copying, clipping and
+// blanking checks.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 4;
+const uint32_t maxLines = 40000;
+const uint32_t waveCount = 16;
+
+struct Result {
+  uint32_t byteCount;
+  uint32_t sampleCount;
+  double addMs;
+  double renderMs;
+};
+
+template <typename F>
+Result run(F addFrame) {
+  CountingWriter writer;
+  CountingSingleWriter brightnessWriter;
+  LinearBrightnessTransform brightnessTransform(&brightnessWriter);
+  Renderer renderer(increment, writer, &brightnessWriter, &brightnessTransform, maxLines, 0,
+                    maxLines + waveCount * 2);
+
+  double addSeconds = measure([&]() {
+    renderer.clear();
+    addFrame(renderer);
+  });
+  uint32_t byteCount = renderer.getLineCount() * sizeof(Line) +
+                       (renderer.getStripLineCount() + renderer.getStripCount()) * sizeof(Vector2);
+
+  writer.reset();
+  uint32_t frames = 0;
+  double renderSeconds = measure([&]() {
+    renderer.render();
+    frames++;
+  });
+
+  return {byteCount, (uint32_t)(writer.getCount() / frames), addSeconds * 1e3,
+          renderSeconds * 1e3};
+}
+
+int main(int argc, char** argv) {
+  printf("%-10s %-10s %8s %9s %9s %9s %9s\n", "vertices", "primitive", "bytes", "samples",
+         "add ms", "render ms", "total ms");
+
+  for (uint32_t vertexCount = 64; vertexCount <= 1024; vertexCount *= 4) {
+    Array<Vector2> waves(waveCount * vertexCount);
+    for (uint32_t i = 0; i < waveCount; i++) {
+      for (uint32_t j = 0; j < vertexCount; j++) {
+        float x = -1.1f + 2.2f * j / (vertexCount - 1);
+        waves[i * vertexCount + j] = {x, -0.7f + i * 0.1f + 0.1f * sinf(x * (i + 3))};
+      }
+    }
+
+    Result polylines = run([&](Renderer& renderer) {
+      for (uint32_t i = 0; i < waveCount; i++) {
+        renderer.addPolyline(&waves[i * vertexCount], vertexCount, 0.8);
+      }
+    });
+    Result lines = run([&](Renderer& renderer) {
+      for (uint32_t i = 0; i < waveCount; i++) {
+        for (uint32_t j = 0; j + 1 < vertexCount; j++) {
+          renderer.add({waves[i * vertexCount + j], waves[i * vertexCount + j + 1], 0.8});
+        }
+      }
+    });
+
+    const char* names[] = {"polylines", "lines"};
+    const Result* results[] = {&polylines, &lines};
+    for (uint32_t i = 0; i < 2; i++) {
+      printf("%-10u %-10s %8u %9u %9.3f %9.3f %9.3f\n", vertexCount, names[i],
+             results[i]->byteCount, results[i]->sampleCount, results[i]->addMs,
+             results[i]->renderMs, results[i]->addMs + results[i]->renderMs);
+    }
+  }
+
+  return 0;
+}
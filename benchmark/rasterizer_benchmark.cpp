@@ -0,0 +1,88 @@
+// Line rasterization micro-benchmark
+//
+// Draws a fixed set of random lines with every LineAlgorithm and reports samples per second,
+// along with the largest deviation of each algorithm from the Float implementation.
+
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+// Writer that stores the samples for comparing the algorithms
+class RecordingWriter : public DualDACWriter {
+ public:
+  mutable std::vector<Pair<uint32_t>> samples;
+
+  uint32_t getMaxValue() const { return 4095; }
+  void write(const uint32_t x, const uint32_t y) const { samples.push_back({x, y}); }
+};
+
+struct Algorithm {
+  const char* name;
+  LineAlgorithm value;
+};
+
+const Algorithm algorithms[] = {{"Float", LineAlgorithm::Float},
+                                {"FixedPoint", LineAlgorithm::FixedPoint},
+                                {"Bresenham", LineAlgorithm::Bresenham}};
+const uint32_t increments[] = {1, 2, 4, 16};
+const uint32_t lineCount = 1000;
+
+uint32_t getMaxDeviation(const std::vector<Line>& lines, const LineAlgorithm algorithm,
+                         const uint32_t increment) {
+  RecordingWriter reference, writer;
+  Rasterizer referenceRasterizer(reference, LineAlgorithm::Float);
+  Rasterizer rasterizer(writer, algorithm);
+
+  for (const Line& line : lines) {
+    referenceRasterizer.drawLine(line.a, line.b, increment);
+    rasterizer.drawLine(line.a, line.b, increment);
+  }
+
+  if (reference.samples.size() != writer.samples.size()) {
+    return UINT32_MAX;
+  }
+
+  uint32_t deviation = 0;
+  for (size_t i = 0; i < writer.samples.size(); i++) {
+    int32_t dx = abs((int32_t)writer.samples[i].a - (int32_t)reference.samples[i].a);
+    int32_t dy = abs((int32_t)writer.samples[i].b - (int32_t)reference.samples[i].b);
+    deviation = std::max(deviation, (uint32_t)std::max(dx, dy));
+  }
+  return deviation;
+}
+
+int main(int argc, char** argv) {
+  Random random;
+  std::vector<Line> lines;
+  for (uint32_t i = 0; i < lineCount; i++) {
+    lines.push_back({{random.next(-1.0, 1.0), random.next(-1.0, 1.0)},
+                     {random.next(-1.0, 1.0), random.next(-1.0, 1.0)},
+                     1.0});
+  }
+
+  printf("%-12s %9s %14s %13s\n", "algorithm", "increment", "Msamples/s", "max deviation");
+
+  for (const Algorithm& algorithm : algorithms) {
+    for (uint32_t increment : increments) {
+      CountingWriter writer;
+      Rasterizer rasterizer(writer, algorithm.value);
+      auto drawLines = [&]() {
+        for (const Line& line : lines) {
+          rasterizer.drawLine(line.a, line.b, increment);
+        }
+      };
+
+      drawLines();
+      uint64_t samplesPerFrame = writer.getCount();
+      double seconds = measure(drawLines);
+
+      printf("%-12s %9u %14.2f %13u\n", algorithm.name, increment,
+             samplesPerFrame / seconds / 1e6, getMaxDeviation(lines, algorithm.value, increment));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,290 @@
+// Scene benchmark
+//
+// Renders a suite of standard scenes without a display and reports the time spent per frame in
+// each stage of the pipeline, lines and samples per frame, frames per second and a checksum of the
+// samples of the first frame. The checksums are deterministic, so comparing them between two
+// builds tells whether an optimization changed the rendered output.
+
+#include "ChecksumWriter.h"
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 2;
+const uint32_t maxLines = 40000;
+const uint32_t frameCacheCapacity = 1000000;
+
+// Mesh imported from examples/example.obj, identical to the one in examples/import.ino
+Vector3 importVertices[] = {
+    {-0.5, -0.5, 0.5},  {0.5, -0.5, 0.5},  {-0.5, 0.5, 0.5},   {0.5, 0.5, 0.5},
+    {-0.5, 0.5, -0.5},  {0.5, 0.5, -0.5},  {-0.5, -0.5, -0.5}, {0.5, -0.5, -0.5},
+    {3.5, -0.5, -0.5},  {3.5, -0.5, 0.5},  {3.5, 0.5, -0.5},   {3.5, 0.5, 0.5},
+    {-0.5, 3.5, 0.5},   {0.5, 3.5, 0.5},   {0.5, 3.5, -0.5},   {-0.5, 3.5, -0.5},
+    {-0.5, -0.5, 3.5},  {0.5, -0.5, 3.5},  {0.5, 0.5, 3.5},    {-0.5, 0.5, 3.5},
+    {-3.5, -0.5, -0.5}, {-3.5, -0.5, 0.5}, {-3.5, 0.5, 0.5},   {-3.5, 0.5, -0.5},
+    {-0.5, 0.5, -3.5},  {0.5, 0.5, -3.5},  {0.5, -0.5, -3.5},  {-0.5, -0.5, -3.5},
+    {-0.5, -3.5, -0.5}, {0.5, -3.5, -0.5}, {0.5, -3.5, 0.5},   {-0.5, -3.5, 0.5}};
+FaceDefinition importFaces[] = {
+    {16, 17, 18, 19}, {12, 13, 14, 15}, {24, 25, 26, 27}, {28, 29, 30, 31}, {9, 8, 10, 11},
+    {20, 21, 22, 23}, {1, 7, 8, 9},     {7, 5, 10, 8},    {5, 3, 11, 10},   {3, 1, 9, 11},
+    {2, 3, 13, 12},   {3, 5, 14, 13},   {5, 4, 15, 14},   {4, 2, 12, 15},   {0, 1, 17, 16},
+    {1, 3, 18, 17},   {3, 2, 19, 18},   {2, 0, 16, 19},   {6, 0, 21, 20},   {0, 2, 22, 21},
+    {2, 4, 23, 22},   {4, 6, 20, 23},   {4, 5, 25, 24},   {5, 7, 26, 25},   {7, 6, 27, 26},
+    {6, 4, 24, 27},   {6, 7, 29, 28},   {7, 1, 30, 29},   {1, 0, 31, 30},   {0, 6, 28, 31}};
+
+// Open tube of unit radius along the z axis, reaching from z = -length / 2 to z = length / 2
+Mesh* createTube(const uint32_t sides, const float length) {
+  Vector3* vertices = new Vector3[sides * 2];
+  FaceDefinition* faces = new FaceDefinition[sides];
+
+  for (uint32_t i = 0; i < sides; i++) {
+    float angle = 2.0 * PI * i / sides;
+    vertices[i] = {cosf(angle), sinf(angle), -length * 0.5f};
+    vertices[i + sides] = {cosf(angle), sinf(angle), length * 0.5f};
+  }
+  for (uint32_t i = 0; i < sides; i++) {
+    uint32_t j = (i + 1) % sides;
+    faces[i] = {i, j, j + sides, i + sides};
+  }
+
+  Mesh* mesh = new Mesh(vertices, sides * 2, faces, sides);
+
+  for (uint32_t i = 0; i < sides; i++) {
+    delete[] faces[i].vertexIndices;
+  }
+  delete[] faces;
+  delete[] vertices;
+
+  return mesh;
+}
+
+// A scene adds its geometry for the given frame number, so every run renders identical frames
+class Scene {
+ public:
+  const char* name;
+
+  Scene(const char* name) : name(name) {}
+  virtual ~Scene() {}
+
+  virtual void add(Renderer& renderer, const uint32_t frame) = 0;
+};
+
+// Objects sharing one mesh, spinning in front of a camera orbiting the origin
+class ObjectScene : public Scene {
+  Mesh* mesh;
+  Array<Object*> objects;
+  float distance;
+
+ public:
+  ObjectScene(const char* name, Mesh* mesh, const uint32_t objectCount, const float distance)
+      : Scene(name), mesh(mesh), objects(objectCount), distance(distance) {
+    for (uint32_t i = 0; i < objectCount; i++) {
+      objects[i] = new Object(mesh);
+    }
+  }
+
+  ~ObjectScene() {
+    for (uint32_t i = 0; i < objects.getCapacity(); i++) {
+      delete objects[i];
+    }
+    delete mesh;
+  }
+
+  Object* getObject(const uint32_t i) { return objects[i]; }
+
+  void add(Renderer& renderer, const uint32_t frame) {
+    float phase = frame * 0.01;
+    LookAtCamera camera;
+    camera.setEye(sinf(phase) * distance, distance * 0.5f, cosf(phase) * distance);
+
+    for (uint32_t i = 0; i < objects.getCapacity(); i++) {
+      objects[i]->setRotation(phase, phase * 0.5f, 0);
+    }
+
+    renderer.add(objects, camera);
+  }
+};
+
+// Grid of cubes on the xz plane
+class CubeGridScene : public ObjectScene {
+ public:
+  CubeGridScene(const uint32_t size)
+      : ObjectScene("cube-grid", MeshBuilder::createCube(0.5), size * size, size * 1.2f) {
+    for (uint32_t z = 0; z < size; z++) {
+      for (uint32_t x = 0; x < size; x++) {
+        getObject(z * size + x)->setTranslation(x - (size - 1) * 0.5f, 0, z - (size - 1) * 0.5f);
+      }
+    }
+  }
+};
+
+// Objects and camera that don't move, so that each object reuses the lines of the previous frame
+// from its transform cache
+class StaticScene : public Scene {
+  Mesh* mesh;
+  Array<Object*> objects;
+  TransformCache* caches;
+  LookAtCamera camera;
+
+ public:
+  StaticScene(const char* name, Mesh* mesh, const uint32_t objectCount)
+      : Scene(name), mesh(mesh), objects(objectCount) {
+    caches = new TransformCache[objectCount];
+    for (uint32_t i = 0; i < objectCount; i++) {
+      objects[i] = new Object(mesh);
+      objects[i]->setTranslation((i - (objectCount - 1) * 0.5f) * 2.5f, 0, 0);
+      objects[i]->setRotation(i * 0.3f, i * 0.2f, 0);
+      objects[i]->setTransformCache(&caches[i]);
+    }
+    camera.setEye(0, 1.0, objectCount * 2.0f);
+  }
+
+  ~StaticScene() {
+    for (uint32_t i = 0; i < objects.getCapacity(); i++) {
+      delete objects[i];
+    }
+    delete[] caches;
+    delete mesh;
+  }
+
+  void add(Renderer& renderer, const uint32_t frame) { renderer.add(objects, camera); }
+};
+
+// Random 2D lines added directly to the renderer
+class LineScene : public Scene {
+  Line* lines;
+  uint32_t lineCount;
+
+ public:
+  LineScene(const uint32_t lineCount) : Scene("lines"), lineCount(lineCount) {
+    Random random;
+    lines = new Line[lineCount];
+    for (uint32_t i = 0; i < lineCount; i++) {
+      lines[i] = {{random.next(-1.2, 1.2), random.next(-0.9, 0.9)},
+                  {random.next(-1.2, 1.2), random.next(-0.9, 0.9)},
+                  1.0};
+    }
+  }
+
+  ~LineScene() { delete[] lines; }
+
+  void add(Renderer& renderer, const uint32_t frame) {
+    for (uint32_t i = 0; i < lineCount; i++) {
+      renderer.add(lines[i]);
+    }
+  }
+};
+
+// Nested tubes around a camera looking along them. Every lengthwise edge crosses the near plane,
+// and one end of each tube is behind the camera.
+class NearClipScene : public Scene {
+  Mesh* mesh;
+  Array<Object*> objects;
+
+ public:
+  NearClipScene(const uint32_t tubeCount, const uint32_t sides)
+      : Scene("near-clip"), mesh(createTube(sides, 20.0)), objects(tubeCount) {
+    for (uint32_t i = 0; i < tubeCount; i++) {
+      float radius = 0.25f * (i + 1);
+      objects[i] = new Object(mesh);
+      objects[i]->setScaling(radius, radius, 1.0);
+    }
+  }
+
+  ~NearClipScene() {
+    for (uint32_t i = 0; i < objects.getCapacity(); i++) {
+      delete objects[i];
+    }
+    delete mesh;
+  }
+
+  void add(Renderer& renderer, const uint32_t frame) {
+    float phase = frame * 0.01;
+    FreeCamera camera;
+    camera.setRotation(sinf(phase) * 0.2f, cosf(phase) * 0.2f, phase);
+
+    renderer.add(objects, camera);
+  }
+};
+
+void printHeader() {
+  printf("%-14s %7s %9s %8s %9s %9s %9s %9s %9s  %-16s\n", "scene", "lines", "samples", "fps",
+         "cull ms", "xform ms", "clip ms", "raster ms", "total ms", "checksum");
+}
+
+// Renders the scene directly to the writer, or through a frame cache
+void run(Scene& scene, const bool isCached = false) {
+  ChecksumWriter writer;
+  FrameCache* frameCache = isCached ? new FrameCache(frameCacheCapacity, writer) : nullptr;
+  Renderer* renderer = isCached ? new Renderer(increment, *frameCache, nullptr, maxLines)
+                                : new Renderer(increment, writer, nullptr, nullptr, maxLines);
+
+  // Checksum the first frame, then measure the animated frames
+  scene.add(*renderer, 0);
+  renderer->render();
+  uint32_t lineCount = renderer->getLineCount();
+  uint64_t checksum = writer.getChecksum();
+
+  Timer::resetAll();
+  writer.reset();
+
+  uint32_t frame = 0;
+  double seconds = measure([&]() {
+    renderer->clear();
+    scene.add(*renderer, frame++);
+    renderer->render();
+  });
+
+  Timer* faceCulling = Timer::find("faceCulling");
+  Timer* transform = Timer::find("transform");
+  Timer* clip = Timer::find("clip");
+  Timer* rasterize = Timer::find("rasterize");
+
+  auto msPerFrame = [&](Timer* timer) {
+    return timer != nullptr ? timer->getTotal() / frame * 1e3 : 0.0;
+  };
+
+  char name[32];
+  snprintf(name, sizeof(name), "%s%s", scene.name, isCached ? "+cache" : "");
+  printf("%-14s %7u %9u %8.1f %9.3f %9.3f %9.3f %9.3f %9.3f  %016llx\n", name, lineCount,
+         (uint32_t)(writer.getCount() / frame), 1.0 / seconds, msPerFrame(faceCulling),
+         msPerFrame(transform), msPerFrame(clip), msPerFrame(rasterize), seconds * 1e3,
+         (unsigned long long)checksum);
+
+  delete renderer;
+  delete frameCache;
+}
+
+int main(int argc, char** argv) {
+  printHeader();
+
+  CubeGridScene cubeGrid(8);
+  run(cubeGrid);
+
+  for (uint32_t subdivisions = 1; subdivisions <= 5; subdivisions++) {
+    static char names[5][16];
+    snprintf(names[subdivisions - 1], sizeof(names[0]), "icosphere-%u", subdivisions);
+    ObjectScene icosphere(names[subdivisions - 1],
+                          MeshBuilder::createIcosphere(1.0, subdivisions), 1, 2.5);
+    run(icosphere);
+  }
+
+  ObjectScene import("import", new Mesh(importVertices, 32, importFaces, 30), 1, 12.0);
+  run(import);
+
+  StaticScene staticScene("static", MeshBuilder::createIcosphere(1.0, 4), 1);
+  run(staticScene);
+  run(staticScene, true);
+
+  StaticScene staticObjects("static-8", MeshBuilder::createIcosphere(1.0, 2), 8);
+  run(staticObjects);
+  run(staticObjects, true);
+
+  LineScene lines(900);
+  run(lines);
+
+  NearClipScene nearClip(16, 64);
+  run(nearClip);
+
+  return 0;
+}
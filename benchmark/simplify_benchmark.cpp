@@ -0,0 +1,89 @@
+// Edge simplification benchmark
+//
+// Renders an icosphere with 5 subdivisions at increasing distances with and without the edge
+// simplifier, and reports the lines, blanking jumps and samples per frame and the time spent
+// simplifying against the total frame time (including the blanking). Without simplification the
+// line count stays the same however small the sphere gets on screen.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t increment = 1;
+const uint32_t maxLines = 10000;
+
+// Counts the brightness writes turning the beam off, i.e. the blanking jumps
+class JumpCountingWriter final : public SingleDACWriter {
+  mutable uint64_t count;
+
+ public:
+  JumpCountingWriter() : count(0) {}
+
+  uint32_t getMaxValue() const { return 4095; }
+  void write(const uint32_t value) const { count += value == 0; }
+
+  uint64_t getCount() const { return count; }
+  void reset() { count = 0; }
+};
+
+struct Result {
+  uint32_t lineCount;
+  uint32_t jumpCount;
+  uint32_t sampleCount;
+  double simplifyMs;
+  double totalMs;
+};
+
+Result run(Object& object, const float distance, EdgeSimplifier* edgeSimplifier) {
+  CountingWriter writer;
+  JumpCountingWriter brightnessWriter;
+  LinearBrightnessTransform brightnessTransform(&brightnessWriter);
+  Renderer renderer(increment, writer, &brightnessWriter, &brightnessTransform, maxLines);
+  renderer.setEdgeSimplifier(edgeSimplifier);
+  LookAtCamera camera;
+  camera.setEye(0, 0, distance);
+
+  renderer.add(&object, camera);
+  uint32_t lineCount = renderer.getLineCount();
+  renderer.render();
+
+  Timer::resetAll();
+  writer.reset();
+  brightnessWriter.reset();
+
+  // Rotate the sphere, so that the lines are transformed and simplified again every frame
+  uint32_t frame = 0;
+  double seconds = measure([&]() {
+    object.setRotation(0, frame++ * 0.01f, 0);
+    renderer.clear();
+    renderer.add(&object, camera);
+    renderer.render();
+  });
+
+  Timer* timer = Timer::find("simplify");
+  double simplifyMs = timer != nullptr ? timer->getTotal() / frame * 1e3 : 0.0;
+  return {lineCount, (uint32_t)(brightnessWriter.getCount() / frame),
+          (uint32_t)(writer.getCount() / frame), simplifyMs, seconds * 1e3};
+}
+
+int main(int argc, char** argv) {
+  printf("%-9s %7s %7s %7s %7s %9s %9s %11s %9s %9s\n", "distance", "lines", "simple", "jumps",
+         "simple", "samples", "simple", "simplify ms", "off ms", "on ms");
+
+  Mesh* mesh = MeshBuilder::createIcosphere(1.0, 5);
+  Object object(mesh);
+  // Collapse detail smaller than the spot
+  EdgeSimplifier edgeSimplifier(8.0, 0.5, maxLines);
+
+  const float distances[] = {3, 10, 30, 60, 90};
+  for (float distance : distances) {
+    Result off = run(object, distance, nullptr);
+    Result on = run(object, distance, &edgeSimplifier);
+    printf("%-9.0f %7u %7u %7u %7u %9u %9u %11.3f %9.3f %9.3f\n", distance, off.lineCount,
+           on.lineCount, off.jumpCount, on.jumpCount, off.sampleCount, on.sampleCount,
+           on.simplifyMs, off.totalMs, on.totalMs);
+  }
+
+  delete mesh;
+  return 0;
+}
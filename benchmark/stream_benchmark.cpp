@@ -0,0 +1,92 @@
+// SampleStream benchmark
+//
+// The producer renders frames of varying length into the stream while a consumer thread replays
+// them to a writer which verifies that the samples of every frame arrive in order and that no
+// frame is torn. Each sample encodes its frame number in x and its index within the frame in y.
+
+#include <atomic>
+
+#include "../emulator/SampleStreamThread.h"
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t frameCount = 500;
+const uint32_t maxFrameLength = 4000;
+
+class VerifyingWriter : public DualDACWriter {
+  mutable uint32_t frame = 0;
+  mutable uint32_t expectedIndex = 0;
+
+ public:
+  mutable std::atomic<uint64_t> sampleCount{0};
+  mutable std::atomic<uint64_t> replayedFrameCount{0};
+  mutable std::atomic<uint64_t> errorCount{0};
+
+  uint32_t getMaxValue() const { return 4095; }
+
+  void write(const uint32_t x, const uint32_t y) const {
+    if (y == 0) {
+      // Frame boundary: the previous frame has to have been replayed completely
+      if (expectedIndex != 0) {
+        errorCount++;
+      }
+      frame = x;
+      expectedIndex = 0;
+    }
+    if (x != frame || y != expectedIndex) {
+      errorCount++;
+    }
+
+    expectedIndex = y + 1;
+    if (expectedIndex == getFrameLength(frame)) {
+      expectedIndex = 0;
+      replayedFrameCount++;
+    }
+    sampleCount++;
+  }
+
+  static uint32_t getFrameLength(const uint32_t frame) {
+    return 1 + (frame * 2654435761u) % maxFrameLength;
+  }
+};
+
+int main(int argc, char** argv) {
+  typedef std::chrono::steady_clock Clock;
+
+  VerifyingWriter writer;
+  SampleStream stream(maxFrameLength, writer);
+  DualDACWriter& streamWriter = stream.getLineWriter();
+
+  double waitSeconds = 0;
+  Clock::time_point begin = Clock::now();
+  {
+    SampleStreamThread consumer(stream);
+
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+      Clock::time_point waitBegin = Clock::now();
+      stream.begin();
+      waitSeconds += std::chrono::duration<double>(Clock::now() - waitBegin).count();
+
+      uint32_t x = frame % 4096;
+      for (uint32_t i = 0; i < VerifyingWriter::getFrameLength(x); i++) {
+        streamWriter.write(x, i);
+      }
+      stream.end();
+
+      // Simulate computing the next frame
+      Clock::time_point computeEnd = Clock::now() + std::chrono::microseconds(50);
+      while (Clock::now() < computeEnd) {
+      }
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  printf("frames produced:       %u\n", frameCount);
+  printf("frames replayed:       %llu\n", (unsigned long long)writer.replayedFrameCount);
+  printf("replayed Msamples/s:   %.2f\n", writer.sampleCount / seconds / 1e6);
+  printf("producer wait:         %.2f %%\n", waitSeconds / seconds * 100);
+  printf("errors:                %llu\n", (unsigned long long)writer.errorCount);
+
+  return writer.errorCount == 0 ? 0 : 1;
+}
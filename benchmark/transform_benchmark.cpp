@@ -0,0 +1,68 @@
+// Vertex transform benchmark
+//
+// Compares the structure-of-arrays batch transform of VertexStore with the previous per-vertex
+// loop over interleaved vertex data, including the perspective divide.
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+// Vertex layout and transform loop used before VertexStore
+struct InterleavedVertex {
+  Vector3 original;
+  Vector4 transformed;
+  bool isVisible;
+};
+
+void transformInterleaved(InterleavedVertex* vertices, const uint32_t count, const Matrix& matrix) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (vertices[i].isVisible) {
+      Vector3& original = vertices[i].original;
+      vertices[i].transformed = Vector4Transform({original.x, original.y, original.z, 1.0}, matrix);
+    }
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (vertices[i].isVisible) {
+      float div = 1.0 / vertices[i].transformed.w;
+      vertices[i].transformed.x *= div;
+      vertices[i].transformed.y *= div;
+      vertices[i].transformed.z *= div;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  FreeCamera camera;
+  camera.setTranslation(0, 0, 3.0);
+  Matrix matrix = MatrixMultiply(MatrixRotateXYZ({0.3, 0.5, 0}),
+                                 MatrixMultiply(camera.getViewMatrix(),
+                                                camera.getProjectionMatrix()));
+
+  printf("%-14s %8s %16s %16s\n", "mesh", "vertices", "AoS Mvertices/s", "SoA Mvertices/s");
+
+  for (uint32_t subdivisions = 2; subdivisions <= 6; subdivisions++) {
+    Mesh* mesh = MeshBuilder::createIcosphere(1.0, subdivisions);
+    uint32_t count = mesh->vertexCount;
+
+    InterleavedVertex* interleaved = new InterleavedVertex[count];
+    for (uint32_t i = 0; i < count; i++) {
+      interleaved[i] = {mesh->vertices[i], {0, 0, 0, 0}, true};
+    }
+    VertexStore store(count);
+    store.setAllVisible(true);
+
+    double interleavedSeconds =
+        measure([&]() { transformInterleaved(interleaved, count, matrix); });
+    double storeSeconds = measure([&]() { store.transform(mesh->vertices, count, matrix); });
+
+    char name[32];
+    snprintf(name, sizeof(name), "icosphere-%u", subdivisions);
+    printf("%-14s %8u %16.1f %16.1f\n", name, count, count / interleavedSeconds / 1e6,
+           count / storeSeconds / 1e6);
+
+    delete[] interleaved;
+    delete mesh;
+  }
+
+  return 0;
+}
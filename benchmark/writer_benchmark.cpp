@@ -0,0 +1,96 @@
+// Writer dispatch benchmark
+//
+// Compares the per-sample cost of writing through the virtual writer interfaces (Rasterizer,
+// Renderer) with the compile-time resolved ones (BasicRasterizer, StaticRenderer).
+
+#include <vector>
+
+#include "benchmark.h"
+
+using namespace voltage;
+
+const uint32_t lineCount = 1000;
+
+std::vector<Line> createLines(const float maxLength) {
+  Random random;
+  std::vector<Line> lines;
+  for (uint32_t i = 0; i < lineCount; i++) {
+    Vector2 a = {random.next(-1.0, 1.0 - maxLength), random.next(-0.75, 0.75 - maxLength)};
+    Vector2 b = {a.x + random.next(0, maxLength), a.y + random.next(0, maxLength)};
+    lines.push_back({a, b, random.next(0.2, 1.0)});
+  }
+  return lines;
+}
+
+template <typename R>
+double measureRasterizer(const R& rasterizer, const CountingWriter& writer,
+                         const std::vector<Line>& lines) {
+  auto drawLines = [&]() {
+    for (const Line& line : lines) {
+      rasterizer.drawLine(line.a, line.b, 1);
+    }
+  };
+
+  drawLines();
+  uint64_t samplesPerFrame = writer.getCount();
+  return measure(drawLines) / samplesPerFrame;
+}
+
+// Short lines with brightness ramps in between, so that a large share of the samples are written
+// by the brightness writer
+double measureRenderer(Renderer& renderer, const CountingWriter& writer,
+                       const CountingSingleWriter& brightnessWriter,
+                       const std::vector<Line>& lines) {
+  auto render = [&]() {
+    renderer.clear();
+    for (const Line& line : lines) {
+      renderer.add(line);
+    }
+    renderer.render();
+  };
+
+  render();
+  uint64_t samplesPerFrame = writer.getCount() + brightnessWriter.getCount();
+  return measure(render) / samplesPerFrame;
+}
+
+int main(int argc, char** argv) {
+  printf("%-30s %14s %14s %8s\n", "path", "virtual ns", "static ns", "speedup");
+
+  for (LineAlgorithm algorithm :
+       {LineAlgorithm::Float, LineAlgorithm::FixedPoint, LineAlgorithm::Bresenham}) {
+    std::vector<Line> lines = createLines(1.0);
+    CountingWriter virtualWriter, staticWriter;
+    Rasterizer virtualRasterizer(virtualWriter, algorithm);
+    BasicRasterizer<CountingWriter> staticRasterizer(staticWriter, algorithm);
+
+    double virtualSeconds = measureRasterizer(virtualRasterizer, virtualWriter, lines);
+    double staticSeconds = measureRasterizer(staticRasterizer, staticWriter, lines);
+
+    const char* names[] = {"rasterizer (Float)", "rasterizer (FixedPoint)",
+                           "rasterizer (Bresenham)"};
+    printf("%-30s %14.3f %14.3f %7.2fx\n", names[(int)algorithm], virtualSeconds * 1e9,
+           staticSeconds * 1e9, virtualSeconds / staticSeconds);
+  }
+
+  std::vector<Line> lines = createLines(0.05);
+  CountingWriter virtualWriter, staticWriter;
+  CountingSingleWriter virtualBrightnessWriter, staticBrightnessWriter;
+  LinearBrightnessTransform virtualTransform(&virtualBrightnessWriter);
+  Final<LinearBrightnessTransform> staticTransform(&staticBrightnessWriter);
+
+  Renderer virtualRenderer(1, virtualWriter, &virtualBrightnessWriter, &virtualTransform,
+                           lineCount);
+  StaticRenderer<CountingWriter, CountingSingleWriter, Final<LinearBrightnessTransform>>
+      staticRenderer(1, staticWriter, &staticBrightnessWriter, &staticTransform, lineCount);
+
+  double virtualSeconds =
+      measureRenderer(virtualRenderer, virtualWriter, virtualBrightnessWriter, lines);
+  double staticSeconds =
+      measureRenderer(staticRenderer, staticWriter, staticBrightnessWriter, lines);
+
+  printf("%-30s %14.3f %14.3f %7.2fx\n", "renderer (with brightness)", virtualSeconds * 1e9,
+         staticSeconds * 1e9, virtualSeconds / staticSeconds);
+
+  return 0;
+}
@@ -13,4 +13,10 @@ class SDL2Writer : public voltage::DualDACWriter {
   uint32_t getMaxValue() const { return resolution - 1; }
 
   void write(const uint32_t x, const uint32_t y) const { buffer[y * resolution + x] = 0xFFFFFFFF; }
+
+  void writeBatch(const uint32_t *samples, const uint32_t count) const {
+    for (uint32_t i = 0; i < count; i++) {
+      buffer[(samples[i] >> 16) * resolution + (samples[i] & 0xFFFF)] = 0xFFFFFFFF;
+    }
+  }
 };
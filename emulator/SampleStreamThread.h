@@ -0,0 +1,35 @@
+#ifndef VOLTAGE_SAMPLE_STREAM_THREAD_H_
+#define VOLTAGE_SAMPLE_STREAM_THREAD_H_
+
+#include <atomic>
+#include <thread>
+
+#include "../Voltage/src/SampleStream.h"
+
+// Consumer for SampleStream, which replays the finished frames in a background thread
+// (similarly to a timer interrupt on Teensy)
+class SampleStreamThread {
+  voltage::SampleStream &stream;
+  const uint32_t samplesPerReplay;
+  std::atomic<bool> isRunning;
+  std::thread thread;
+
+ public:
+  SampleStreamThread(voltage::SampleStream &stream, const uint32_t samplesPerReplay = 1024)
+      : stream(stream), samplesPerReplay(samplesPerReplay), isRunning(true) {
+    thread = std::thread([this]() {
+      // Yield between the replays so that the renderer can run even on a single core
+      while (isRunning) {
+        this->stream.replay(this->samplesPerReplay);
+        std::this_thread::yield();
+      }
+    });
+  }
+
+  ~SampleStreamThread() {
+    isRunning = false;
+    thread.join();
+  }
+};
+
+#endif
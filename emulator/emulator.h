@@ -6,6 +6,7 @@
 #include <functional>
 
 #define VOLTAGE_EMULATOR
+#include "../Voltage/src/Timer.h"
 #include "../Voltage/src/Voltage.h"
 #include "SDL2Writer.h"
 
@@ -45,6 +46,10 @@ class Emulator {
             (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
           quit = 1;
         }
+        // Dump profiling statistics (see Timer.h) when P is pressed
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p) {
+          voltage::Timer::dump();
+        }
       }
 
       for (int i = 0; i < resolution * resolution; i++) {
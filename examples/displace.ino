@@ -13,7 +13,7 @@ voltage::FreeCamera camera;
 void setup() {
   // Copy the original icosphere coordinates
   for (unsigned int i = 0; i < mesh->vertexCount; i++) {
-    vertices[i] = mesh->vertices[i].original;
+    vertices[i] = mesh->vertices[i];
   }
 
   camera.setTranslation(0, 0, 5.0);
@@ -21,14 +21,18 @@ void setup() {
 
 float phase = 0;
 void loop() {
+  Vector3 *meshVertices = mesh->getWritableVertices();
   for (unsigned int i = 0; i < mesh->vertexCount; i++) {
     // Define a scaling factor based on sine, phase and the original position of the vertex
     float scale = sin(((phase * 3.0) + vertices[i].x + vertices[i].y) * 3.0) * 0.5 + 1.0;
 
     // Scale the original coordinate
-    mesh->vertices[i].original = Vector3Scale(vertices[i], scale);
+    meshVertices[i] = Vector3Scale(vertices[i], scale);
   }
 
+  // Keep the bounding sphere up to date, as it's used for frustum culling
+  mesh->calculateBoundingSphere();
+
   object->setRotation(0, 0, phase);
 
   renderer.clear();
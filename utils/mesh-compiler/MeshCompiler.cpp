@@ -0,0 +1,397 @@
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshCompiler.h"
+
+using namespace voltage;
+
+namespace {
+
+void append(std::string& output, const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  output += buffer;
+}
+
+// Six significant digits are enough for the values typically found in OBJ files, other values
+// get the nine digits needed for reading back the same float
+std::string formatFloat(const float value) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.6g", value);
+  if (strtof(buffer, nullptr) != value) {
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+  }
+  return buffer;
+}
+
+std::string formatVector(const Vector3& vector) {
+  return "{" + formatFloat(vector.x) + ", " + formatFloat(vector.y) + ", " +
+         formatFloat(vector.z) + "}";
+}
+
+// Writes the elements of an array initializer, wrapped to 100 columns
+class ListWriter {
+  std::string& output;
+  uint32_t column;
+  bool isEmpty;
+
+ public:
+  // Elements start from the next line
+  ListWriter(std::string& output, const std::string& declaration)
+      : output(output), column(100), isEmpty(true) {
+    output += declaration + " = {";
+  }
+
+  void add(const std::string& element) {
+    if (!isEmpty) {
+      output += ",";
+      column++;
+    }
+    if (column + element.size() + 2 > 100) {
+      output += "\n    ";
+      column = 4;
+    } else if (!isEmpty) {
+      output += " ";
+      column++;
+    }
+    output += element;
+    column += element.size();
+    isEmpty = false;
+  }
+
+  void end() { output += "};\n"; }
+};
+
+std::string formatEdge(const Edge& edge) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "{{%u, %u}, {%d, %d}}", edge.vertices.a, edge.vertices.b,
+           edge.faces.a, edge.faces.b);
+  return buffer;
+}
+
+struct PositionHash {
+  size_t operator()(const Vector3& v) const {
+    uint32_t bits[3];
+    memcpy(bits, &v, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+  }
+};
+
+struct PositionEquals {
+  bool operator()(const Vector3& a, const Vector3& b) const {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+  }
+};
+
+uint16_t quantize(const float value, const float offset, const float scale) {
+  if (scale == 0) {
+    return 0;
+  }
+  return (uint16_t)fminf(fmaxf(roundf((value - offset) / scale), 0), UINT16_MAX);
+}
+
+}  // namespace
+
+bool MeshCompiler::parseObj(const char* text, Model& model, std::string& error) {
+  model = Model();
+  uint32_t lineNumber = 1;
+
+  auto fail = [&](const char* message) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "line %u: %s", lineNumber, message);
+    error = buffer;
+    return false;
+  };
+
+  for (const char* line = text; *line != '\0'; lineNumber++) {
+    const char* end = strchr(line, '\n');
+    if (end == nullptr) {
+      end = line + strlen(line);
+    }
+
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+      char* next = (char*)line + 1;
+      float values[3];
+      for (uint32_t i = 0; i < 3; i++) {
+        char* start = next;
+        values[i] = strtof(start, &next);
+        if (next == start || next > end) {
+          return fail("invalid vertex");
+        }
+      }
+      // Adding zero turns negative zeros positive, so that they are welded with positive ones
+      model.vertices.push_back({values[0] + 0.0f, values[1] + 0.0f, values[2] + 0.0f});
+    } else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+      char* next = (char*)line + 1;
+      uint32_t vertexCount = 0;
+      while (true) {
+        char* start = next;
+        long index = strtol(start, &next, 10);
+        if (next == start || next > end) {
+          break;
+        }
+
+        // Negative indices are relative to the end of the vertex list
+        if (index < 0) {
+          index += model.vertices.size() + 1;
+        }
+        if (index <= 0) {
+          return fail("invalid vertex index");
+        }
+        model.faceVertices.push_back(index - 1);
+        vertexCount++;
+
+        // Skip texture coordinate and normal indices
+        while (*next != ' ' && *next != '\t' && next < end) {
+          next++;
+        }
+      }
+      if (vertexCount < 3) {
+        return fail("face with less than three vertices");
+      }
+      model.faceVertexCounts.push_back(vertexCount);
+    }
+
+    line = *end == '\n' ? end + 1 : end;
+  }
+
+  for (uint32_t index : model.faceVertices) {
+    if (index >= model.vertices.size()) {
+      error = "vertex index out of range";
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t MeshCompiler::weldVertices(Model& model) {
+  const uint32_t none = UINT32_MAX;
+  uint32_t vertexCount = model.vertices.size();
+
+  // Map every vertex to the first vertex with the same position
+  std::unordered_map<Vector3, uint32_t, PositionHash, PositionEquals> positions;
+  positions.reserve(vertexCount);
+  std::vector<uint32_t> remap(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    remap[i] = positions.emplace(model.vertices[i], i).first->second;
+  }
+
+  // Remove repeated vertices of the faces, and faces left without an area
+  std::vector<uint32_t> faceVertexCounts;
+  std::vector<uint32_t> faceVertices;
+  std::vector<uint32_t> newIndices(vertexCount, none);
+  uint32_t first = 0;
+  for (uint32_t count : model.faceVertexCounts) {
+    uint32_t start = faceVertices.size();
+    for (uint32_t j = 0; j < count; j++) {
+      uint32_t index = remap[model.faceVertices[first + j]];
+      if (faceVertices.size() == start || faceVertices.back() != index) {
+        faceVertices.push_back(index);
+      }
+    }
+    while (faceVertices.size() - start > 1 && faceVertices.back() == faceVertices[start]) {
+      faceVertices.pop_back();
+    }
+    if (faceVertices.size() - start < 3) {
+      faceVertices.resize(start);
+    } else {
+      faceVertexCounts.push_back(faceVertices.size() - start);
+    }
+    first += count;
+  }
+
+  // Drop unused vertices, keeping the order of the rest
+  std::vector<bool> isUsed(vertexCount, false);
+  for (uint32_t index : faceVertices) {
+    isUsed[index] = true;
+  }
+  std::vector<Vector3> vertices;
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    if (isUsed[i]) {
+      newIndices[i] = vertices.size();
+      vertices.push_back(model.vertices[i]);
+    }
+  }
+  for (uint32_t& index : faceVertices) {
+    index = newIndices[index];
+  }
+
+  model.vertices.swap(vertices);
+  model.faceVertexCounts.swap(faceVertexCounts);
+  model.faceVertices.swap(faceVertices);
+  return vertexCount - model.vertices.size();
+}
+
+MeshCompiler::Quantization MeshCompiler::quantizeVertices(Model& model) {
+  if (model.vertices.empty()) {
+    return {{0, 0, 0}, {0, 0, 0}};
+  }
+
+  Vector3 min = model.vertices[0];
+  Vector3 max = model.vertices[0];
+  for (const Vector3& v : model.vertices) {
+    min = {fminf(min.x, v.x), fminf(min.y, v.y), fminf(min.z, v.z)};
+    max = {fmaxf(max.x, v.x), fmaxf(max.y, v.y), fmaxf(max.z, v.z)};
+  }
+
+  Quantization quantization = {min,
+                               {(max.x - min.x) / UINT16_MAX, (max.y - min.y) / UINT16_MAX,
+                                (max.z - min.z) / UINT16_MAX}};
+  const Vector3& offset = quantization.offset;
+  const Vector3& scale = quantization.scale;
+
+  // Same expressions as in the code generated by writeHeader, so that the normals and the bounding
+  // sphere are calculated from the vertices seen at runtime
+  for (Vector3& v : model.vertices) {
+    v = {offset.x + (float)quantize(v.x, offset.x, scale.x) * scale.x,
+         offset.y + (float)quantize(v.y, offset.y, scale.y) * scale.y,
+         offset.z + (float)quantize(v.z, offset.z, scale.z) * scale.z};
+  }
+  return quantization;
+}
+
+Mesh* MeshCompiler::buildMesh(const Model& model, const MeshCleanup* cleanup) {
+  uint32_t faceCount = model.faceVertexCounts.size();
+  FaceDefinition* faces = new FaceDefinition[faceCount];
+
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < faceCount; i++) {
+    faces[i] = FaceDefinition(model.faceVertexCounts[i]);
+    std::copy(model.faceVertices.begin() + first,
+              model.faceVertices.begin() + first + faces[i].vertexCount, faces[i].vertexIndices);
+    first += faces[i].vertexCount;
+  }
+
+  Mesh* mesh = cleanup != nullptr
+                   ? new Mesh(model.vertices.data(), model.vertices.size(), faces, faceCount,
+                              *cleanup)
+                   : new Mesh(model.vertices.data(), model.vertices.size(), faces, faceCount);
+
+  for (uint32_t i = 0; i < faceCount; i++) {
+    delete[] faces[i].vertexIndices;
+  }
+  delete[] faces;
+  return mesh;
+}
+
+std::string MeshCompiler::writeHeader(const Mesh& mesh, const char* name, const Format format,
+                                      const Quantization* quantization) {
+  std::string output;
+  std::string prefix(name);
+  append(output, "// %u vertices, %u faces and %u edges in %u strips\n", mesh.vertexCount,
+         mesh.faceCount, mesh.edgeCount, mesh.stripCount);
+
+  if (format == Format::Definitions) {
+    ListWriter vertices(output, "const Vector3 " + prefix + "Vertices[]");
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+      vertices.add(formatVector(mesh.vertices[i]));
+    }
+    vertices.end();
+
+    ListWriter faces(output, "voltage::FaceDefinition " + prefix + "Faces[]");
+    for (uint32_t i = 0; i < mesh.faceCount; i++) {
+      std::string face = "{";
+      for (uint32_t j = 0; j < mesh.faces[i].vertexCount; j++) {
+        face += (j > 0 ? ", " : "") + std::to_string(mesh.getFaceVertex(mesh.faces[i], j));
+      }
+      faces.add(face + "}");
+    }
+    faces.end();
+
+    ListWriter edges(output, "const voltage::EdgeDefinition " + prefix + "Edges[]");
+    for (uint32_t i = 0; i < mesh.edgeCount; i++) {
+      edges.add(formatEdge(mesh.edges[i]));
+    }
+    edges.end();
+
+    std::string constructor = "new voltage::Mesh(" + prefix + "Vertices, " +
+                              std::to_string(mesh.vertexCount) + ", " + prefix + "Faces, " +
+                              std::to_string(mesh.faceCount) + ", " + prefix + "Edges, " +
+                              std::to_string(mesh.edgeCount) + ");\n";
+    std::string variable = "voltage::Mesh* " + prefix + " =";
+    bool isWrapped = variable.size() + constructor.size() >= 100;
+    output += variable + (isWrapped ? "\n    " : " ") + constructor;
+    return output;
+  }
+
+  if (quantization != nullptr) {
+    ListWriter positions(output, "const uint16_t " + prefix + "Positions[]");
+    const Vector3& offset = quantization->offset;
+    const Vector3& scale = quantization->scale;
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+      const Vector3& v = mesh.vertices[i];
+      positions.add(std::to_string(quantize(v.x, offset.x, scale.x)));
+      positions.add(std::to_string(quantize(v.y, offset.y, scale.y)));
+      positions.add(std::to_string(quantize(v.z, offset.z, scale.z)));
+    }
+    positions.end();
+    append(output, "Vector3 %sVertices[%u];\n", name, mesh.vertexCount);
+  } else {
+    ListWriter vertices(output, "const Vector3 " + prefix + "Vertices[]");
+    for (uint32_t i = 0; i < mesh.vertexCount; i++) {
+      vertices.add(formatVector(mesh.vertices[i]));
+    }
+    vertices.end();
+  }
+
+  ListWriter faceVertices(output, "const uint32_t " + prefix + "FaceVertices[]");
+  for (uint32_t i = 0; i < mesh.faceCount; i++) {
+    for (uint32_t j = 0; j < mesh.faces[i].vertexCount; j++) {
+      faceVertices.add(std::to_string(mesh.getFaceVertex(mesh.faces[i], j)));
+    }
+  }
+  faceVertices.end();
+
+  ListWriter faces(output, "const voltage::Face " + prefix + "Faces[]");
+  for (uint32_t i = 0; i < mesh.faceCount; i++) {
+    const Face& face = mesh.faces[i];
+    faces.add("{" + std::to_string(face.firstVertex) + ", " + std::to_string(face.vertexCount) +
+              ", " + formatVector(face.normal) + "}");
+  }
+  faces.end();
+
+  ListWriter edges(output, "const voltage::Edge " + prefix + "Edges[]");
+  for (uint32_t i = 0; i < mesh.edgeCount; i++) {
+    edges.add(formatEdge(mesh.edges[i]));
+  }
+  edges.end();
+
+  const Vector4& sphere = mesh.boundingSphere;
+  ListWriter data(output, "const voltage::MeshData " + prefix + "Data");
+  data.add(prefix + "Vertices");
+  data.add(std::to_string(mesh.vertexCount));
+  data.add(prefix + "FaceVertices");
+  data.add(prefix + "Faces");
+  data.add(std::to_string(mesh.faceCount));
+  data.add(prefix + "Edges");
+  data.add(std::to_string(mesh.edgeCount));
+  data.add("{" + formatFloat(sphere.x) + ", " + formatFloat(sphere.y) + ", " +
+           formatFloat(sphere.z) + ", " + formatFloat(sphere.w) + "}");
+  data.end();
+
+  if (quantization == nullptr) {
+    append(output, "voltage::Mesh* %s = new voltage::Mesh(%sData);\n", name, name);
+    return output;
+  }
+
+  append(output, "\n// Converts the quantized positions to floats in RAM\n");
+  append(output, "const voltage::MeshData& %sDequantize() {\n", name);
+  append(output, "  const Vector3 offset = %s;\n",
+         formatVector(quantization->offset).c_str());
+  append(output, "  const Vector3 scale = %s;\n", formatVector(quantization->scale).c_str());
+  append(output, "  for (uint32_t i = 0; i < %u; i++) {\n", mesh.vertexCount);
+  append(output, "    const uint16_t* p = &%sPositions[i * 3];\n", name);
+  append(output, "    %sVertices[i] = {offset.x + p[0] * scale.x, offset.y + p[1] * scale.y,\n",
+         name);
+  append(output, "                     offset.z + p[2] * scale.z};\n");
+  append(output, "  }\n  return %sData;\n}\n", name);
+  append(output, "voltage::Mesh* %s = new voltage::Mesh(%sDequantize());\n", name, name);
+  return output;
+}
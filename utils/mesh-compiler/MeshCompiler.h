@@ -0,0 +1,58 @@
+#ifndef VOLTAGE_MESH_COMPILER_H_
+#define VOLTAGE_MESH_COMPILER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../Voltage/src/Mesh.h"
+
+namespace voltage {
+namespace MeshCompiler {
+
+enum class Format {
+  // Const arrays referred to by a MeshData, which stay in flash and need no work at boot
+  Data,
+  // Vertex, face and edge definitions copied to RAM by the edge-aware Mesh constructor
+  Definitions
+};
+
+// Vertices quantized to 16 bits per axis are stored as offset + value * scale
+struct Quantization {
+  Vector3 offset;
+  Vector3 scale;
+};
+
+// Polygons of an OBJ file, with the vertex indices of all faces stored contiguously
+struct Model {
+  std::vector<Vector3> vertices;
+  std::vector<uint32_t> faceVertexCounts;
+  std::vector<uint32_t> faceVertices;
+};
+
+// Reads the vertices and faces of OBJ text. Texture coordinates, normals, lines and groups are
+// ignored. Returns false and sets the error on malformed input.
+bool parseObj(const char* text, Model& model, std::string& error);
+
+// Merges vertices with exactly the same position and removes unused vertices, then drops the
+// repeated vertices and faces left with less than three of them. Returns the number of removed
+// vertices.
+uint32_t weldVertices(Model& model);
+
+// Rounds the vertices to the values they get back after quantizing them to 16 bits per axis
+Quantization quantizeVertices(Model& model);
+
+// Generates the edges, strips, normals and bounding sphere with the library's Mesh, optionally
+// welding nearby vertices and removing coplanar edges
+Mesh* buildMesh(const Model& model, const MeshCleanup* cleanup = nullptr);
+
+// C++ code defining a voltage::Mesh* variable with the given name. With a quantization (only
+// supported by the data format), the vertices are stored as 16-bit integers, which are converted
+// to floats in RAM at boot.
+std::string writeHeader(const Mesh& mesh, const char* name, const Format format,
+                        const Quantization* quantization = nullptr);
+
+}  // namespace MeshCompiler
+}  // namespace voltage
+
+#endif
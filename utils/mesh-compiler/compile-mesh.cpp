@@ -0,0 +1,100 @@
+// Compiles an OBJ file to C++ code defining a precomputed voltage::Mesh
+//
+// Usage: ./compile-mesh [--definitions] [--quantize] [--weld=<distance>] [--coplanar=<degrees>]
+//                       <filename> <output-variable>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "MeshCompiler.h"
+
+using namespace voltage;
+
+bool readFile(const char* filename, std::string& text) {
+  FILE* file = fopen(filename, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  char buffer[65536];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.append(buffer, size);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  MeshCompiler::Format format = MeshCompiler::Format::Data;
+  bool isQuantized = false;
+  MeshCleanup cleanup = {0, 0};
+  const char* arguments[2];
+  int argumentCount = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--definitions") == 0) {
+      format = MeshCompiler::Format::Definitions;
+    } else if (strcmp(argv[i], "--quantize") == 0) {
+      isQuantized = true;
+    } else if (strncmp(argv[i], "--weld=", 7) == 0) {
+      cleanup.weldDistance = strtof(argv[i] + 7, nullptr);
+    } else if (strncmp(argv[i], "--coplanar=", 11) == 0) {
+      cleanup.coplanarAngle = strtof(argv[i] + 11, nullptr) * PI / 180.0f;
+    } else if (argumentCount < 2 && argv[i][0] != '-') {
+      arguments[argumentCount++] = argv[i];
+    } else {
+      argumentCount = -1;
+      break;
+    }
+  }
+
+  if (argumentCount != 2 || (isQuantized && format == MeshCompiler::Format::Definitions)) {
+    fprintf(stderr,
+            "Usage: ./compile-mesh [--definitions] [--quantize] [--weld=<distance>]\n"
+            "                      [--coplanar=<degrees>] <filename> <output-variable>\n\n"
+            "By default the mesh is output as const arrays, which stay in flash. --definitions\n"
+            "outputs vertex, face and edge definitions copied to RAM instead. --quantize stores\n"
+            "the vertices as 16-bit integers and can't be combined with --definitions.\n"
+            "--weld merges vertices closer than the distance, and --coplanar removes edges\n"
+            "between faces whose normals differ less than the angle.\n");
+    return 1;
+  }
+
+  std::string text;
+  if (!readFile(arguments[0], text)) {
+    fprintf(stderr, "%s: can't read file\n", arguments[0]);
+    return 1;
+  }
+
+  MeshCompiler::Model model;
+  std::string error;
+  if (!MeshCompiler::parseObj(text.c_str(), model, error)) {
+    fprintf(stderr, "%s: %s\n", arguments[0], error.c_str());
+    return 1;
+  }
+
+  // Faces left without an area are removed, and a mesh without faces would be written as empty
+  // arrays, which don't compile
+  uint32_t weldedCount = MeshCompiler::weldVertices(model);
+  if (model.faceVertexCounts.empty()) {
+    fprintf(stderr, "%s: no faces\n", arguments[0]);
+    return 1;
+  }
+  MeshCompiler::Quantization quantization;
+  if (isQuantized) {
+    quantization = MeshCompiler::quantizeVertices(model);
+  }
+
+  Mesh* mesh = MeshCompiler::buildMesh(model, &cleanup);
+  std::string header =
+      MeshCompiler::writeHeader(*mesh, arguments[1], format, isQuantized ? &quantization : nullptr);
+  fputs(header.c_str(), stdout);
+
+  fprintf(stderr, "%u vertices (%u welded), %u faces, %u edges, %u strips\n", mesh->vertexCount,
+          weldedCount, mesh->faceCount, mesh->edgeCount, mesh->stripCount);
+  delete mesh;
+  return 0;
+}